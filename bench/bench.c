@@ -0,0 +1,676 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * synthetic benchmarks for the toolkit's hot paths. each one is timed
+ * per iteration and reported as JSON on stdout (or to the file given
+ * with -o), with percentiles so that runs can be compared.
+ *
+ *     bench [-o out.json] [name-substring ...]
+ *
+ * best run against a headless build, where the frames aren't paced by
+ * anything but the renderer.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/surface.h>
+#include <rutabaga/layout.h>
+#include <rutabaga/container.h>
+#include <rutabaga/platform.h>
+
+#include <rutabaga/widgets/knob.h>
+#include <rutabaga/widgets/label.h>
+#include <rutabaga/widgets/patchbay.h>
+
+#define WINDOW_W 1280
+#define WINDOW_H 800
+
+#define KNOB_GROUPS    10
+#define KNOB_ROWS      10
+#define KNOBS_PER_ROW  100
+
+#define CHAIN_DEPTH    512
+
+#define PATCHBAY_NODES 1000
+#define NODES_PER_ROW  25
+
+#define LABELS         1000
+#define LABELS_PER_ROW 20
+
+struct scene {
+	struct rtb_element *root;
+
+	/* the elements benchmarks poke at individually */
+	struct rtb_element **leaves;
+	int nleaves;
+
+	/* the leaves that are on screen once the scene is shown. most of
+	 * each scene is culled, and dirtying one of those draws nothing. */
+	struct rtb_element **visible;
+	int nvisible;
+};
+
+typedef void (*bench_fn_t)(struct scene *, int iteration);
+
+static struct {
+	struct rutabaga *rtb;
+	struct rtb_window *win;
+
+	FILE *out;
+	int nreported;
+
+	char **only;
+	int nonly;
+} bench;
+
+/**
+ * reporting
+ */
+
+static int
+compare_u64(const void *_a, const void *_b)
+{
+	const uint64_t *a = _a, *b = _b;
+	return (*a > *b) - (*a < *b);
+}
+
+static double
+percentile(const uint64_t *sorted, int n, double p)
+{
+	int rank = (int) ((p / 100.) * n + .5);
+
+	if (rank < 1)
+		rank = 1;
+	else if (rank > n)
+		rank = n;
+
+	return sorted[rank - 1] / 1000.;
+}
+
+static void
+report(const char *name, uint64_t *samples, int n)
+{
+	uint64_t total = 0;
+	int i;
+
+	qsort(samples, n, sizeof(*samples), compare_u64);
+
+	for (i = 0; i < n; i++)
+		total += samples[i];
+
+	fprintf(bench.out,
+			"%s\n\t\t{\"name\": \"%s\", \"iterations\": %d, \"unit\": \"us\", "
+			"\"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+			"\"max\": %.3f, \"mean\": %.3f}",
+			bench.nreported++ ? "," : "",
+			name, n,
+			samples[0] / 1000.,
+			percentile(samples, n, 50.),
+			percentile(samples, n, 90.),
+			percentile(samples, n, 99.),
+			samples[n - 1] / 1000.,
+			(total / (double) n) / 1000.);
+}
+
+/**
+ * running
+ */
+
+static int
+wanted(const char *name)
+{
+	int i;
+
+	if (!bench.nonly)
+		return 1;
+
+	for (i = 0; i < bench.nonly; i++)
+		if (strstr(name, bench.only[i]))
+			return 1;
+
+	return 0;
+}
+
+static void
+run(const char *name, struct scene *scene, bench_fn_t fn, int iterations)
+{
+	uint64_t *samples, start;
+	int i;
+
+	if (!wanted(name))
+		return;
+
+	samples = calloc(iterations, sizeof(*samples));
+	assert(samples);
+
+	/* once to build whatever gets built lazily. */
+	fn(scene, 0);
+
+	for (i = 0; i < iterations; i++) {
+		start = uv_hrtime();
+		fn(scene, i);
+		samples[i] = uv_hrtime() - start;
+	}
+
+	report(name, samples, iterations);
+	free(samples);
+}
+
+static void
+redraw(void)
+{
+	rtb_surface_invalidate(RTB_SURFACE(bench.win));
+	rtb_window_draw(bench.win, 0);
+}
+
+static void
+collect_visible(struct scene *scene)
+{
+	int i;
+
+	scene->visible = calloc(scene->nleaves, sizeof(*scene->visible));
+	assert(scene->visible);
+	scene->nvisible = 0;
+
+	for (i = 0; i < scene->nleaves; i++)
+		if (rtb_elem_is_visible(scene->leaves[i]))
+			scene->visible[scene->nvisible++] = scene->leaves[i];
+}
+
+static void
+show(struct scene *scene)
+{
+	rtb_elem_add_child(RTB_ELEMENT(bench.win), scene->root, RTB_ADD_TAIL);
+	redraw();
+	glFinish();
+
+	collect_visible(scene);
+}
+
+static void
+hide(struct scene *scene)
+{
+	/* the process is on its way out by the time we're done, so the
+	 * scene itself is left for the OS to clean up. */
+	rtb_elem_remove_child(RTB_ELEMENT(bench.win), scene->root);
+	free(scene->visible);
+	free(scene->leaves);
+}
+
+/**
+ * benchmarks
+ */
+
+static void
+bench_reflow(struct scene *scene, int i)
+{
+	rtb_elem_reflow_leafward(RTB_ELEMENT(bench.win));
+}
+
+static void
+bench_restyle(struct scene *scene, int i)
+{
+	struct rtb_element *win = RTB_ELEMENT(bench.win);
+
+	rtb_elem_invalidate_style(win, RTB_RESTYLE_TREE);
+	rtb_elem_restyle_pending(win);
+}
+
+static void
+bench_draw_full(struct scene *scene, int i)
+{
+	redraw();
+	glFinish();
+}
+
+static void
+bench_draw_damage(struct scene *scene, int i)
+{
+	assert(scene->nvisible > 0);
+	rtb_elem_mark_dirty(scene->visible[(i * 7919) % scene->nvisible]);
+	rtb_window_draw(bench.win, 0);
+	glFinish();
+}
+
+static void
+bench_hit_test(struct scene *scene, int i)
+{
+	/* cheap and deterministic, so runs are comparable. */
+	unsigned int h = (i + 1) * 2654435761u;
+
+	rtb__platform_mouse_motion(bench.win,
+			h % WINDOW_W, (h >> 16) % WINDOW_H);
+}
+
+static void
+bench_set_text(struct scene *scene, int i)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "label %d", i * 31);
+	rtb_label_set_text(RTB_ELEMENT_AS(scene->leaves[i % scene->nleaves],
+				rtb_label), buf);
+}
+
+/**
+ * scenes
+ */
+
+static struct rtb_element *
+container(rtb_elem_cb_t layout, rtb_elem_cb_size_t size)
+{
+	rtb_container_t *self = rtb_container_new();
+
+	assert(self);
+	rtb_elem_set_layout(self, layout);
+	rtb_elem_set_size_cb(self, size);
+
+	return self;
+}
+
+static void
+alloc_leaves(struct scene *scene, int n)
+{
+	scene->leaves = calloc(n, sizeof(*scene->leaves));
+	scene->nleaves = 0;
+	assert(scene->leaves);
+}
+
+/* knobs in rows in groups, which is about as deep as real UIs nest. */
+static void
+build_knobs(struct scene *scene)
+{
+	struct rtb_element *group, *row;
+	struct rtb_knob *knob;
+	int g, r, k;
+
+	alloc_leaves(scene, KNOB_GROUPS * KNOB_ROWS * KNOBS_PER_ROW);
+	scene->root = container(rtb_layout_vpack_top, rtb_size_fill);
+
+	for (g = 0; g < KNOB_GROUPS; g++) {
+		group = container(rtb_layout_vpack_top, rtb_size_hfill);
+
+		for (r = 0; r < KNOB_ROWS; r++) {
+			row = container(rtb_layout_hpack_left, rtb_size_hfill);
+
+			for (k = 0; k < KNOBS_PER_ROW; k++) {
+				knob = rtb_knob_new();
+				rtb_container_add(row, RTB_ELEMENT(knob));
+				scene->leaves[scene->nleaves++] = RTB_ELEMENT(knob);
+			}
+
+			rtb_container_add(group, row);
+		}
+
+		rtb_container_add(scene->root, group);
+	}
+}
+
+static void
+build_chain(struct scene *scene)
+{
+	struct rtb_element *link, *next;
+	struct rtb_knob *knob;
+	int i;
+
+	alloc_leaves(scene, 1);
+	scene->root = link = container(rtb_layout_vpack_top, rtb_size_fill);
+
+	for (i = 0; i < CHAIN_DEPTH; i++) {
+		next = container(rtb_layout_vpack_top, rtb_size_hfill);
+		rtb_container_add(link, next);
+		link = next;
+	}
+
+	knob = rtb_knob_new();
+	rtb_container_add(link, RTB_ELEMENT(knob));
+	scene->leaves[scene->nleaves++] = RTB_ELEMENT(knob);
+}
+
+static void
+build_patchbay(struct scene *scene)
+{
+	struct rtb_patchbay_port *in, *out;
+	struct rtb_patchbay_node *node;
+	struct rtb_patchbay *pb;
+	char name[32];
+	int i;
+
+	alloc_leaves(scene, PATCHBAY_NODES);
+
+	pb = rtb_patchbay_new();
+	rtb_elem_set_size_cb(RTB_ELEMENT(pb), rtb_size_fill);
+	scene->root = RTB_ELEMENT(pb);
+
+	for (i = 0; i < PATCHBAY_NODES; i++) {
+		snprintf(name, sizeof(name), "node %d", i);
+		node = rtb_patchbay_node_new(pb, name);
+
+		in = calloc(1, sizeof(*in));
+		out = calloc(1, sizeof(*out));
+		rtb_patchbay_port_init(in, node, "in", PORT_TYPE_INPUT,
+				RTB_ADD_TAIL);
+		rtb_patchbay_port_init(out, node, "out", PORT_TYPE_OUTPUT,
+				RTB_ADD_TAIL);
+
+		node->x = 20.f + (i % NODES_PER_ROW) * 240.f;
+		node->y = 20.f + (i / NODES_PER_ROW) * 120.f;
+
+		rtb_elem_add_child(RTB_ELEMENT(pb), RTB_ELEMENT(node),
+				RTB_ADD_TAIL);
+		scene->leaves[scene->nleaves++] = RTB_ELEMENT(node);
+	}
+}
+
+static void
+connect_patchbay(struct scene *scene)
+{
+	struct rtb_patchbay *pb = RTB_ELEMENT_AS(scene->root, rtb_patchbay);
+	struct rtb_patchbay_node *prev, *node;
+	struct rtb_patchbay_port *from, *to;
+	int i;
+
+	/* chain every node's output to the next one's input. */
+	for (i = 1; i < scene->nleaves; i++) {
+		prev = RTB_ELEMENT_AS(scene->leaves[i - 1], rtb_patchbay_node);
+		node = RTB_ELEMENT_AS(scene->leaves[i], rtb_patchbay_node);
+
+		from = RTB_ELEMENT_AS(TAILQ_FIRST(&prev->output_ports.children),
+				rtb_patchbay_port);
+		to = RTB_ELEMENT_AS(TAILQ_FIRST(&node->input_ports.children),
+				rtb_patchbay_port);
+
+		rtb_patchbay_connect_ports(pb, from, to);
+	}
+}
+
+static void
+build_labels(struct scene *scene)
+{
+	struct rtb_element *row = NULL;
+	struct rtb_label *label;
+	char buf[32];
+	int i;
+
+	alloc_leaves(scene, LABELS);
+	scene->root = container(rtb_layout_vpack_top, rtb_size_fill);
+
+	for (i = 0; i < LABELS; i++) {
+		if (!(i % LABELS_PER_ROW)) {
+			row = container(rtb_layout_hpack_left, rtb_size_hfill);
+			rtb_container_add(scene->root, row);
+		}
+
+		snprintf(buf, sizeof(buf), "label %d", i);
+		label = rtb_label_new(buf);
+		rtb_container_add(row, RTB_ELEMENT(label));
+		scene->leaves[scene->nleaves++] = RTB_ELEMENT(label);
+	}
+}
+
+/**
+ * main
+ */
+
+static void
+run_knobs(void)
+{
+	struct scene scene;
+
+	build_knobs(&scene);
+	show(&scene);
+
+	run("knobs-10k/reflow", &scene, bench_reflow, 50);
+	run("knobs-10k/restyle", &scene, bench_restyle, 50);
+	run("knobs-10k/draw-full", &scene, bench_draw_full, 100);
+	run("knobs-10k/draw-damage", &scene, bench_draw_damage, 500);
+	run("knobs-10k/hit-test", &scene, bench_hit_test, 5000);
+
+	hide(&scene);
+}
+
+static void
+run_chain(void)
+{
+	struct scene scene;
+
+	build_chain(&scene);
+	show(&scene);
+
+	run("chain-512/reflow", &scene, bench_reflow, 200);
+	run("chain-512/restyle", &scene, bench_restyle, 200);
+	run("chain-512/hit-test", &scene, bench_hit_test, 5000);
+
+	hide(&scene);
+}
+
+static void
+run_patchbay(void)
+{
+	struct scene scene;
+
+	build_patchbay(&scene);
+	show(&scene);
+	connect_patchbay(&scene);
+
+	run("patchbay-1k/reflow", &scene, bench_reflow, 50);
+	run("patchbay-1k/draw-full", &scene, bench_draw_full, 100);
+	run("patchbay-1k/draw-damage", &scene, bench_draw_damage, 500);
+	run("patchbay-1k/hit-test", &scene, bench_hit_test, 5000);
+
+	hide(&scene);
+}
+
+static void
+run_labels(void)
+{
+	struct scene scene;
+
+	build_labels(&scene);
+	show(&scene);
+
+	run("labels-1k/set-text", &scene, bench_set_text, 5000);
+	run("labels-1k/draw-full", &scene, bench_draw_full, 100);
+
+	hide(&scene);
+}
+
+#define FIELD_END(field) (offsetof(struct rtb_element, field)	\
+		+ sizeof(((struct rtb_element *) 0)->field))
+
+/* how far into an element the fields reflow, hit-testing and culling
+ * read go, which is what decides how many cache lines of each element a
+ * walk over the tree touches. */
+static size_t
+walked_bytes(void)
+{
+	const size_t ends[] = {
+		FIELD_END(rect), FIELD_END(flags), FIELD_END(align),
+		FIELD_END(outer_pad), FIELD_END(inner_pad), FIELD_END(children),
+		FIELD_END(state), FIELD_END(visibility), FIELD_END(inner_rect),
+		FIELD_END(min_size), FIELD_END(max_size),
+		FIELD_END(parent), FIELD_END(window), FIELD_END(surface),
+		FIELD_END(child), FIELD_END(child_index),
+
+		FIELD_END(size_cb), FIELD_END(layout_cb),
+#ifdef RTB_SHARED_IMPL
+		FIELD_END(impl)
+#else
+		FIELD_END(reflow)
+#endif
+	};
+
+	size_t i, max = 0;
+
+	for (i = 0; i < sizeof(ends) / sizeof(*ends); i++)
+		if (ends[i] > max)
+			max = ends[i];
+
+	return max;
+}
+
+/* what each element costs before it has drawn anything, so that layouts
+ * of the element structs (and --shared-impl) can be compared. */
+static void
+report_memory(void)
+{
+	fprintf(bench.out,
+			",\n\t\"memory\": {\"unit\": \"bytes\", \"impl\": \"%s\", "
+			"\"element\": %zu, \"walked\": %zu, \"implementation\": %zu, "
+			"\"knob\": %zu, \"label\": %zu, \"patchbay-node\": %zu}",
+#ifdef RTB_SHARED_IMPL
+			"shared",
+#else
+			"inline",
+#endif
+			sizeof(struct rtb_element),
+			walked_bytes(),
+			sizeof(struct rtb_element_implementation),
+			sizeof(struct rtb_knob),
+			sizeof(struct rtb_label),
+			sizeof(struct rtb_patchbay_node));
+}
+
+static int
+parse_args(int argc, char **argv)
+{
+	int i;
+
+	bench.out = stdout;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-o")) {
+			if (++i == argc || !(bench.out = fopen(argv[i], "w"))) {
+				fprintf(stderr, "bench: can't write to %s\n",
+						i < argc ? argv[i] : "(nothing)");
+				return -1;
+			}
+
+			continue;
+		}
+
+		bench.only = &argv[i];
+		bench.nonly = argc - i;
+		break;
+	}
+
+	return 0;
+}
+
+/* far enough up and left that nothing we draw can overlap it. */
+static void
+park(struct rtb_element *elem)
+{
+	elem->x = -WINDOW_W;
+	elem->y = -WINDOW_H;
+}
+
+/* the window resolves its stylesheet when it's attached, and a style
+ * only matches types that have been registered by then, which happens
+ * when the first instance of each is attached. a real UI is built
+ * before its window maps; ours is built afterwards, one scene at a time,
+ * so attach one of everything up front and leave it there, off screen,
+ * where culling keeps it out of the figures. */
+static void
+register_widget_types(void)
+{
+	struct rtb_patchbay_port *port;
+	struct rtb_patchbay_node *node;
+	struct rtb_patchbay *pb;
+	struct rtb_element *holder;
+	struct rtb_knob *knob;
+	struct rtb_label *label;
+
+	holder = container(rtb_layout_unmanaged, rtb_size_self);
+
+	knob = rtb_knob_new();
+	label = rtb_label_new("label");
+	pb = rtb_patchbay_new();
+	node = rtb_patchbay_node_new(pb, "node");
+	port = calloc(1, sizeof(*port));
+	assert(knob && label && pb && node && port);
+
+	rtb_patchbay_port_init(port, node, "port", PORT_TYPE_INPUT,
+			RTB_ADD_TAIL);
+	rtb_elem_add_child(RTB_ELEMENT(pb), RTB_ELEMENT(node), RTB_ADD_TAIL);
+
+	park(RTB_ELEMENT(knob));
+	park(RTB_ELEMENT(label));
+	park(RTB_ELEMENT(pb));
+
+	rtb_container_add(holder, RTB_ELEMENT(knob));
+	rtb_container_add(holder, RTB_ELEMENT(label));
+	rtb_container_add(holder, RTB_ELEMENT(pb));
+	rtb_elem_add_child(RTB_ELEMENT(bench.win), holder, RTB_ADD_TAIL);
+}
+
+int
+main(int argc, char **argv)
+{
+	if (parse_args(argc, argv))
+		return EXIT_FAILURE;
+
+	bench.rtb = rtb_new();
+	assert(bench.rtb);
+	bench.win = rtb_window_open(bench.rtb, WINDOW_W, WINDOW_H, "rtb bench");
+	assert(bench.win);
+
+	register_widget_types();
+
+	/* there's no event loop to get us mapped and sized, so do what
+	 * the platform would have. */
+	rtb_window_reinit(bench.win);
+	bench.win->need_reconfigure = 0;
+
+	fprintf(bench.out, "{\n\t\"benchmarks\": [");
+
+	run_knobs();
+	run_chain();
+	run_patchbay();
+	run_labels();
+
+	fprintf(bench.out, "\n\t]");
+	report_memory();
+	fprintf(bench.out, "\n}\n");
+
+	if (bench.out != stdout)
+		fclose(bench.out);
+
+	rtb_window_lock(bench.win);
+	rtb_window_close(bench.win);
+	rtb_free(bench.rtb);
+
+	return EXIT_SUCCESS;
+}
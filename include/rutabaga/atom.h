@@ -56,11 +56,47 @@ struct rtb_atom_descriptor {
 	RTB_DICT_ENTRY(rtb_atom_descriptor) dict_entry;
 };
 
+struct rtb_style;
+struct rtb_type_class;
+
 struct rtb_type_atom_descriptor {
 	RTB_INHERIT(rtb_atom_descriptor);
+
+	/* number of supertypes. super[] runs nearest first, so the
+	 * supertype at depth `d` from the root is super[depth - 1 - d],
+	 * which makes subtype checks a single compare. */
+	int depth;
+
+	/* the static class declaration caching this descriptor, if any */
+	struct rtb_type_class *cls;
+
+	/* which style in a resolved style list applies to this type.
+	 * see style_for_type() in style.c. */
+	struct {
+		const struct rtb_style *list;
+		unsigned int generation;
+		struct rtb_style *style;
+	} style_cache;
+
 	struct rtb_type_atom_descriptor *super[0];
 };
 
+/**
+ * type classes
+ *
+ * declare one of these statically per element class and pass it to
+ * rtb_type_ref_class() from the class's attached() callback. the name is
+ * only hashed and looked up the first time, after which attaching is a
+ * pointer compare and a reference count.
+ */
+
+struct rtb_type_class {
+	const char *name;
+	struct rtb_type_atom_descriptor *desc;
+};
+
+#define RTB_TYPE_CLASS(type_name) {.name = type_name, .desc = NULL}
+
 /**
  * public API
  */
@@ -71,7 +107,11 @@ struct rtb_type_atom_descriptor *rtb_type_lookup(
 		struct rtb_window *win, const char *type_name);
 int rtb_is_type(struct rtb_type_atom_descriptor *desc,
 		struct rtb_type_atom *atom);
+int rtb_type_is_a(struct rtb_type_atom_descriptor *type,
+		struct rtb_type_atom_descriptor *super);
 
 struct rtb_type_atom_descriptor *rtb_type_ref(struct rtb_window *win,
 		struct rtb_type_atom_descriptor *super, const char *type_name);
+struct rtb_type_atom_descriptor *rtb_type_ref_class(struct rtb_window *win,
+		struct rtb_type_atom_descriptor *super, struct rtb_type_class *cls);
 int rtb_type_unref(struct rtb_type_atom_descriptor *type);
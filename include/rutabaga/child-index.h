@@ -0,0 +1,85 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+#include <rutabaga/geometry.h>
+
+/**
+ * a uniform grid over an element's children, for finding the one under a
+ * point without testing every one of them. elements opt in with
+ * RTB_ELEM_INDEX_CHILDREN and the grid is built the first time it's
+ * needed.
+ *
+ * anything that moves, adds, removes or re-culls children marks the grid
+ * stale, and it gets rebuilt on the next lookup. lookups vastly outnumber
+ * changes while the mouse is moving, which is when this matters.
+ */
+
+/* below this many hit-testable children, we just walk them */
+#define RTB_CHILD_INDEX_MIN_CHILDREN 32
+
+/* cells along each side, at most */
+#define RTB_CHILD_INDEX_MAX_SIDE 64
+
+struct rtb_element;
+
+struct rtb_child_index {
+	int stale;
+	int linear;
+
+	/* the grid covers the bounding box of what was indexed */
+	struct rtb_rect bounds;
+	int cols, rows;
+	GLfloat cell_w, cell_h;
+
+	/* cell `i` holds entries[cells[i]] up to entries[cells[i + 1]],
+	 * topmost first. */
+	unsigned int *cells;
+	struct rtb_element **entries;
+
+	/* scratch for rebuilding: the children being indexed, topmost
+	 * first, and where each cell is being filled from. */
+	struct rtb_element **order;
+	unsigned int *fill;
+
+	/* what's allocated for each of the above, in elements */
+	struct {
+		size_t cells;
+		size_t entries;
+		size_t order;
+		size_t fill;
+	} capacity;
+};
+
+struct rtb_element *rtb_child_index_find(struct rtb_child_index *,
+		struct rtb_element *parent, const struct rtb_point *);
+
+void rtb_child_index_invalidate(struct rtb_child_index *);
+
+struct rtb_child_index *rtb_child_index_new(void);
+void rtb_child_index_free(struct rtb_child_index *);
@@ -0,0 +1,105 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+#include <rutabaga/geometry.h>
+#include <rutabaga/stylequad-batch.h>
+
+#include "wwrl/vector.h"
+
+/**
+ * a display list holds whatever an element queued into its surface's
+ * stylequad batch the last time it drew, so that the next time it can be
+ * queued again without going through the element's draw callback.
+ *
+ * a list is only good for replaying if everything the element drew went
+ * through the batch. anything drawn immediately, or any child drawn other
+ * than with rtb_elem_draw_children(), makes it opaque and the element just
+ * gets drawn the normal way.
+ */
+
+typedef enum {
+	RTB_DISPLAY_LIST_EMPTY,
+	RTB_DISPLAY_LIST_RECORDING,
+	RTB_DISPLAY_LIST_RECORDED,
+	RTB_DISPLAY_LIST_OPAQUE
+} rtb_display_list_state_t;
+
+typedef enum {
+	RTB_DISPLAY_STYLEQUAD,
+
+	/* rtb_elem_draw_children() was called here. */
+	RTB_DISPLAY_CHILDREN
+} rtb_display_command_type_t;
+
+struct rtb_display_command {
+	rtb_display_command_type_t type;
+
+	rtb_stylequad_batch_kind_t kind;
+	GLuint texture;
+	struct rtb_size texture_size;
+
+	/* unclipped, in window coordinates. */
+	struct rtb_rect bounds;
+	struct rtb_stylequad_instance instance;
+};
+
+struct rtb_display_list {
+	rtb_display_list_state_t state;
+
+	/* allocated the first time anything is recorded. */
+	VECTOR(rtb_display_commands, struct rtb_display_command) commands;
+};
+
+struct rtb_element;
+struct rtb_render_context;
+
+void rtb_display_list_record_quad(struct rtb_display_list *,
+		const struct rtb_stylequad_instance *, const struct rtb_rect *bounds,
+		rtb_stylequad_batch_kind_t, GLuint texture,
+		const struct rtb_size *texture_size);
+void rtb_display_list_record_children(struct rtb_display_list *);
+
+void rtb_display_list_begin(struct rtb_display_list *);
+void rtb_display_list_end(struct rtb_display_list *);
+void rtb_display_list_replay(struct rtb_display_list *,
+		struct rtb_element *owner);
+
+/* throws away whatever's been recorded, or stops the recording in
+ * progress from being replayed. */
+void rtb_display_list_invalidate(struct rtb_display_list *);
+void rtb_display_list_make_opaque(struct rtb_display_list *);
+
+static inline int
+rtb_display_list_is_replayable(const struct rtb_display_list *self)
+{
+	return self->state == RTB_DISPLAY_LIST_RECORDED;
+}
+
+void rtb_display_list_init(struct rtb_display_list *);
+void rtb_display_list_fini(struct rtb_display_list *);
@@ -33,6 +33,8 @@ struct rtb_element;
 #include <rutabaga/event.h>
 #include <rutabaga/geometry.h>
 #include <rutabaga/stylequad.h>
+#include <rutabaga/display-list.h>
+#include <rutabaga/child-index.h>
 
 #include "bsd/queue.h"
 #include "wwrl/vector.h"
@@ -43,18 +45,57 @@ struct rtb_element;
 #define RTB_ELEMENT_IS_MARKED_DIRTY(elem)									\
 	(elem->render_entry.tqe_next || elem->render_entry.tqe_prev)
 
+/**
+ * implementation tables
+ *
+ * each element class fills in one static rtb_element_implementation and
+ * installs it with rtb_elem_set_impl(). by default, that copies the table
+ * into the element. built with RTB_SHARED_IMPL (`waf configure
+ * --shared-impl`), elements point at the class's table instead, which
+ * saves a dozen function pointers per element but means the callbacks
+ * can't be changed on a single instance any more. layout_cb and size_cb
+ * stay per-instance either way (see rtb_elem_set_layout()). the library
+ * target exports the define, so code built with `use='rutabaga'` always
+ * sees the same struct layout as the library itself.
+ *
+ * call through RTB_IMPL() so that code works in both modes:
+ *
+ *     RTB_IMPL(elem)->draw(elem);
+ */
+
+#ifdef RTB_SHARED_IMPL
+# define RTB_IMPL(elem) ((elem)->impl)
+#else
+# define RTB_IMPL(elem) (&(elem)->impl)
+#endif
+
 #define RTB_SUBCLASS(self, init_func, copy_impl_to) ({						\
 	int ret;																\
 	if (!(ret = init_func(self)))											\
-		*copy_impl_to = self->impl;											\
+		*copy_impl_to = *RTB_IMPL(self);									\
 	ret;})
 
 typedef enum {
 	RTB_ELEM_NO_FOCUS           = 0,
 	RTB_ELEM_CLICK_FOCUS        = 0x01,
-	RTB_ELEM_TAB_FOCUS          = 0x02
+	RTB_ELEM_TAB_FOCUS          = 0x02,
+
+	/* keep a spatial index of the children for hit-testing. worth it
+	 * for elements with lots of them (see child-index.h). */
+	RTB_ELEM_INDEX_CHILDREN     = 0x04
 } rtb_elem_flags_t;
 
+typedef enum {
+	/* reload this element's own style */
+	RTB_RESTYLE_SELF  = 0x01,
+
+	/* ...and everything underneath it */
+	RTB_RESTYLE_TREE  = 0x02,
+
+	/* private: something underneath is marked */
+	RTB_RESTYLE_BELOW = 0x04
+} rtb_restyle_flags_t;
+
 typedef enum {
 	RTB_STATE_UNATTACHED = 0,
 
@@ -64,7 +105,9 @@ typedef enum {
 
 	RTB_STATE_FOCUS,
 	RTB_STATE_FOCUS_HOVER,
-	RTB_STATE_FOCUS_ACTIVE
+	RTB_STATE_FOCUS_ACTIVE,
+
+	RTB_ELEM_STATE_COUNT
 } rtb_elem_state_t;
 
 /**
@@ -93,6 +136,40 @@ typedef void (*rtb_elem_cb_child_state_t)
 	(struct rtb_element *elem, struct rtb_element *child);
 
 struct rtb_element_implementation {
+	/* the layout pass calls these three on every element it visits, so
+	 * they come first. see struct rtb_element. */
+
+	/**
+	 * rtb_element_implementation.size_cb
+	 *
+	 * called when the element should report its desired size.
+	 */
+	rtb_elem_cb_size_t size_cb;
+
+	/**
+	 * rtb_element_implementation.layout_cb
+	 *
+	 * called when the element should layout its children.
+	 */
+	rtb_elem_cb_t layout_cb;
+
+	/**
+	 * rtb_element_implementation.reflow
+	 *
+	 * called when an element needs to respond to a layout change
+	 * caused by an element above it somewhere in the tree, generally
+	 * by a containing element changing size.
+	 *
+	 * should return 1 if reflow was necessary, 0 if none was, and -1
+	 * in an exceptional condition (for example, if an element is less
+	 * than 1 pixel square in size).
+	 *
+	 * the exceptional condition will not be handled or propagated up
+	 * the tree, but can be useful for debugging.
+	 */
+	rtb_elem_cb_reflow_t reflow;
+
+
 	/**
 	 * rtb_element_implementation.draw
 	 *
@@ -115,21 +192,6 @@ struct rtb_element_implementation {
 	rtb_elem_cb_internal_event_t on_event;
 
 
-	/**
-	 * rtb_element_implementation.size_cb
-	 *
-	 * called when the element should report its desired size.
-	 */
-	rtb_elem_cb_size_t size_cb;
-
-	/**
-	 * rtb_element_implementation.layout_cb
-	 *
-	 * called when the element should layout its children.
-	 */
-	rtb_elem_cb_t layout_cb;
-
-
 	/**
 	 * rtb_element_implementation.attached
 	 *
@@ -168,27 +230,12 @@ struct rtb_element_implementation {
 	/**
 	 * rtb_element_implementation.restyle
 	 *
-	 * called when a parent element's style has changed.
+	 * called from the restyle pass when this element's style needs to be
+	 * reloaded (see rtb_elem_invalidate_style()). it shouldn't recurse,
+	 * since children are marked and restyled on their own.
 	 */
 	rtb_elem_cb_t restyle;
 
-	/**
-	 * rtb_element_implementation.reflow
-	 *
-	 * called when an element needs to respond to a layout change
-	 * caused by an element above it somewhere in the tree, generally
-	 * by a containing element changing size.
-	 *
-	 * should return 1 if reflow was necessary, 0 if none was, and -1
-	 * in an exceptional condition (for example, if an element is less
-	 * than 1 pixel square in size).
-	 *
-	 * the exceptional condition will not be handled or propagated up
-	 * the tree, but can be useful for debugging.
-	 */
-	rtb_elem_cb_reflow_t reflow;
-
-
 	/**
 	 * rtb_element_implementation.mark_dirty
 	 *
@@ -213,14 +260,17 @@ struct rtb_element_event {
 struct rtb_element {
 	RTB_INHERIT(rtb_type_atom);
 
+	/**
+	 * hot: what layout, hit-testing, culling and the tree walks look at.
+	 * kept together at the front so a walk over many elements touches
+	 * as few cache lines of each as it can. the GL and event state that
+	 * only matters to the element itself comes after.
+	 */
+
 	/* public *********************************/
 	RTB_INHERIT_AS(rtb_rect, rect);
 	rtb_elem_flags_t flags;
 
-	RTB_INHERIT_AS(rtb_element_implementation, impl);
-
-	struct rtb_style *style;
-
 	/* XXX: should this stuff be in rtb_style_t? */
 	rtb_alignment_t align;
 	struct rtb_padding outer_pad;
@@ -232,20 +282,51 @@ struct rtb_element {
 	rtb_elem_state_t state;
 	rtb_visibility_t visibility;
 	struct rtb_rect inner_rect;
-	struct rtb_stylequad stylequad;
 
 	/* assign these via the stylesheet */
 	struct rtb_size min_size;
 	struct rtb_size max_size;
 
 	int mouse_in;
+	rtb_restyle_flags_t restyle_pending;
 
 	struct rtb_element *parent;
 	struct rtb_window  *window;
 	struct rtb_surface *surface;
 
-	VECTOR(handlers, struct rtb_event_handler) handlers;
 	TAILQ_ENTRY(rtb_element) child;
+
+	/* with RTB_ELEM_INDEX_CHILDREN, made on the first lookup */
+	struct rtb_child_index *child_index;
+
+	/* public *********************************/
+
+	/* last, so that the callbacks the layout pass makes (size_cb,
+	 * layout_cb and reflow, which lead the implementation table) are
+	 * still hot. inline, the rest of the table trails off into the
+	 * cold part. */
+#ifdef RTB_SHARED_IMPL
+	rtb_elem_cb_size_t size_cb;
+	rtb_elem_cb_t layout_cb;
+	const struct rtb_element_implementation *impl;
+#else
+	RTB_INHERIT_AS(rtb_element_implementation, impl);
+#endif
+
+	/**
+	 * cold
+	 */
+
+	struct rtb_style *style;
+
+	/* private ********************************/
+	struct rtb_stylequad stylequad;
+
+	/* what we queued the last time we drew, dropped whenever we're
+	 * marked dirty, reflowed or restyled. */
+	struct rtb_display_list display_list;
+
+	VECTOR(handlers, struct rtb_event_handler) handlers;
 	TAILQ_ENTRY(rtb_element) render_entry;
 };
 
@@ -277,6 +358,31 @@ int rtb_elem_is_clearable(struct rtb_element *);
 struct rtb_element *rtb_elem_nearest_clearable(struct rtb_element *);
 
 void rtb_elem_mark_dirty(struct rtb_element *);
+
+/**
+ * recomputes the visibility of each of an element's children: children
+ * that fall outside of their surface or that sit entirely underneath a
+ * later sibling with an opaque background-color become
+ * RTB_FULLY_OBSCURED, and are then skipped for drawing, dirty-marking
+ * and hit-testing along with everything below them.
+ *
+ * reflow does this on its own. call it after moving children around
+ * without reflowing their parent.
+ */
+void rtb_elem_cull_children(struct rtb_element *);
+
+/**
+ * returns the topmost child of this element that isn't culled and that
+ * contains `pt`, or NULL if there isn't one.
+ */
+struct rtb_element *rtb_elem_child_at(struct rtb_element *,
+		const struct rtb_point *pt);
+/* restyles are deferred to the next frame. marks `elem` (and, with
+ * RTB_RESTYLE_TREE, everything underneath it) for the restyle pass. */
+void rtb_elem_invalidate_style(struct rtb_element *elem,
+		rtb_restyle_flags_t scope);
+void rtb_elem_restyle_pending(struct rtb_element *root);
+
 void rtb_elem_trigger_reflow(struct rtb_element *,
 		struct rtb_element *instigator, rtb_ev_direction_t direction);
 void rtb_elem_reflow_leafward(struct rtb_element *);
@@ -284,6 +390,8 @@ void rtb_elem_reflow_rootward(struct rtb_element *);
 
 void rtb_elem_request_size(struct rtb_element *,
 		const struct rtb_size *avail, struct rtb_size *want);
+void rtb_elem_set_impl(struct rtb_element *,
+		const struct rtb_element_implementation *impl);
 void rtb_elem_set_size_cb(struct rtb_element *, rtb_elem_cb_size_t size_cb);
 void rtb_elem_set_layout(struct rtb_element *, rtb_elem_cb_t layout_cb);
 void rtb_elem_set_position_from_point(struct rtb_element *, struct rtb_point *);
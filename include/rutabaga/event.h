@@ -52,6 +52,10 @@ enum {
 
 	/**
 	 * dispatched before any drawing happens in a frame.
+	 *
+	 * while a handler for this or RTB_FRAME_END is registered on the
+	 * window, it gets a frame every refresh whether anything changed or
+	 * not. animations should use rtb_window_request_frame() instead.
 	 */
 	RTB_FRAME_START    = SYS(1),
 
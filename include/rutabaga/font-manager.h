@@ -57,6 +57,8 @@ struct rtb_font_manager {
 
 		GLint atlas_pixel;
 		GLint gamma;
+
+		GLint subpixel_shift;
 	} shader;
 
 	texture_atlas_t *atlas;
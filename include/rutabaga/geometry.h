@@ -93,3 +93,71 @@ rtb_rect_update_points_from_size(struct rtb_rect *rect)
 	rect->x2 = rect->x + rect->w;
 	rect->y2 = rect->y + rect->h;
 }
+
+static inline int
+rtb_rect_is_empty(const struct rtb_rect *rect)
+{
+	return rect->w <= 0.f || rect->h <= 0.f;
+}
+
+static inline int
+rtb_rect_intersects(const struct rtb_rect *a, const struct rtb_rect *b)
+{
+	return !rtb_rect_is_empty(a) && !rtb_rect_is_empty(b)
+		&& a->x < b->x2 && b->x < a->x2
+		&& a->y < b->y2 && b->y < a->y2;
+}
+
+/**
+ * returns 1 if `inner` lies entirely within `outer`.
+ */
+static inline int
+rtb_rect_contains(const struct rtb_rect *outer, const struct rtb_rect *inner)
+{
+	return outer->x <= inner->x && outer->y <= inner->y
+		&& inner->x2 <= outer->x2 && inner->y2 <= outer->y2;
+}
+
+/**
+ * stores the overlap of `a` and `b` in `dst`. returns 0 if they don't
+ * overlap, in which case `dst` is left empty.
+ */
+static inline int
+rtb_rect_intersect(struct rtb_rect *dst,
+		const struct rtb_rect *a, const struct rtb_rect *b)
+{
+	if (!rtb_rect_intersects(a, b)) {
+		*dst = (struct rtb_rect) {.x = 0.f};
+		return 0;
+	}
+
+	dst->x  = (a->x  > b->x)  ? a->x  : b->x;
+	dst->y  = (a->y  > b->y)  ? a->y  : b->y;
+	dst->x2 = (a->x2 < b->x2) ? a->x2 : b->x2;
+	dst->y2 = (a->y2 < b->y2) ? a->y2 : b->y2;
+
+	rtb_rect_update_size_from_points(dst);
+	return 1;
+}
+
+/**
+ * grows `dst` to the bounding box of both rects. empty rects don't count.
+ */
+static inline void
+rtb_rect_union(struct rtb_rect *dst, const struct rtb_rect *src)
+{
+	if (rtb_rect_is_empty(src))
+		return;
+
+	if (rtb_rect_is_empty(dst)) {
+		*dst = *src;
+		return;
+	}
+
+	dst->x  = (src->x  < dst->x)  ? src->x  : dst->x;
+	dst->y  = (src->y  < dst->y)  ? src->y  : dst->y;
+	dst->x2 = (src->x2 > dst->x2) ? src->x2 : dst->x2;
+	dst->y2 = (src->y2 > dst->y2) ? src->y2 : dst->y2;
+
+	rtb_rect_update_size_from_points(dst);
+}
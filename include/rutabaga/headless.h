@@ -0,0 +1,75 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/keyboard.h>
+
+/**
+ * the headless platform renders with an EGL context that has no window
+ * system behind it, into a framebuffer object the size of the window.
+ * it runs fine on a software rasterizer, so it's what to build against
+ * (`waf configure --headless`) for performance tests and for rendering
+ * on machines with no display.
+ *
+ * time is virtual. each step of the event loop advances the clock by
+ * one frame interval and draws, without waiting on anything, so a test
+ * runs as fast as the renderer can go.
+ *
+ * mouse input goes in through the rtb__platform_mouse_*() calls in
+ * rutabaga/platform.h. like everything else that touches the window,
+ * they need to be made with the window locked.
+ */
+
+/* what rtb_event_loop_run() advances the clock by each frame */
+#define RTB_HEADLESS_FRAME_NSEC (1000000000 / 60)
+
+/* nanoseconds of virtual time since the rutabaga was created */
+uint64_t rtb_headless_time(struct rutabaga *);
+
+/**
+ * advances the clock by `nsec` and runs a frame. returns 1 if anything
+ * was drawn.
+ */
+int rtb_headless_step(struct rutabaga *, uint64_t nsec);
+
+/**
+ * reads the most recent frame back into `pixels`, which has room for
+ * w * h RGBA8 pixels. rows are top to bottom.
+ */
+int rtb_headless_read_pixels(struct rtb_window *, void *pixels);
+
+int rtb_headless_resize(struct rtb_window *, int w, int h);
+
+/**
+ * synthetic keyboard input. there's no keymap, so callers say what key
+ * and character they mean.
+ */
+void rtb_headless_set_modkeys(struct rtb_window *, rtb_modkey_t);
+void rtb_headless_key(struct rtb_window *, rtb_ev_type_t type,
+		rtb_keysym_t keysym, rtb_utf32_t character);
@@ -33,6 +33,9 @@
 #define RTB_EVENT_MOUSE(x) RTB_UPCAST(x, rtb_event_mouse)
 #define RTB_EVENT_DRAG(x) RTB_UPCAST(x, rtb_event_drag)
 
+/* how many merged motion events rtb_mouse remembers */
+#define RTB_MOUSE_MOTION_HISTORY 32
+
 /**
  * types
  */
@@ -132,6 +135,15 @@ struct rtb_mouse {
 
 	rtb_mouse_button_mask_t buttons_down;
 	rtb_mouse_cursor_t current_cursor;
+
+	/* platforms may merge a run of motion events into the last one.
+	 * while that one's being dispatched, this holds where the pointer
+	 * passed through on the way, oldest first, for widgets that want
+	 * every sample. empty for motion that wasn't merged. */
+	struct {
+		struct rtb_point points[RTB_MOUSE_MOTION_HISTORY];
+		int count;
+	} coalesced;
 };
 
 /**
@@ -0,0 +1,124 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+
+/**
+ * the mutation queue is how threads other than the event loop's get
+ * things done to the UI without taking the window lock. any number of
+ * threads can post to it without blocking or allocating, and the loop
+ * thread applies everything posted at the start of the next frame.
+ *
+ * it's an intrusive MPSC queue (after Dmitry Vyukov's): posting is an
+ * atomic exchange and a store, and the consumer never waits on anyone.
+ */
+
+struct rtb_window;
+struct rtb_label;
+struct rtb_value_element;
+struct rtb_mutation;
+
+typedef void (*rtb_mutation_cb_t)(struct rtb_window *,
+		struct rtb_mutation *, void *ctx);
+
+typedef enum {
+	/* call `call.cb` with the window locked */
+	RTB_MUTATION_CALL,
+
+	/* rtb_value_element_set_value(), as RTB_EVENT_SYNTHETIC */
+	RTB_MUTATION_SET_VALUE,
+
+	/* rtb_label_set_text() */
+	RTB_MUTATION_SET_TEXT
+} rtb_mutation_type_t;
+
+struct rtb_mutation {
+	struct rtb_mutation *next;
+
+	rtb_mutation_type_t type;
+
+	/* set by the rtb_window_post_*() helpers. the queue frees the
+	 * mutation (and `set_text.text`) once it's been applied. */
+	int owned;
+
+	union {
+		struct {
+			rtb_mutation_cb_t cb;
+			void *ctx;
+		} call;
+
+		struct {
+			struct rtb_value_element *elem;
+			float value;
+		} set_value;
+
+		struct {
+			struct rtb_label *label;
+			rtb_utf8_t *text;
+		} set_text;
+	};
+};
+
+struct rtb_mutation_queue {
+	/* producers swap themselves in here */
+	struct rtb_mutation *head;
+
+	/* only ever touched by the consumer */
+	struct rtb_mutation *tail;
+
+	struct rtb_mutation stub;
+};
+
+/**
+ * any thread
+ */
+
+/* posts a mutation the caller owns and fills in. it mustn't be touched
+ * again until it's been applied, which for RTB_MUTATION_CALL is when the
+ * callback gets it back. */
+void rtb_window_post(struct rtb_window *, struct rtb_mutation *);
+
+/* these allocate, so they're not for realtime threads. they return -1
+ * if the allocation failed and nothing was posted. */
+int rtb_window_post_call(struct rtb_window *,
+		rtb_mutation_cb_t cb, void *ctx);
+int rtb_window_post_value(struct rtb_window *,
+		struct rtb_value_element *, float value);
+int rtb_window_post_text(struct rtb_window *,
+		struct rtb_label *, const rtb_utf8_t *text);
+
+/**
+ * event loop thread, window locked
+ */
+
+int rtb_mutation_queue_is_empty(struct rtb_mutation_queue *);
+void rtb_mutation_queue_drain(struct rtb_mutation_queue *,
+		struct rtb_window *);
+
+void rtb_mutation_queue_init(struct rtb_mutation_queue *);
+void rtb_mutation_queue_fini(struct rtb_mutation_queue *);
@@ -61,6 +61,16 @@ void rtb__platform_mouse_leave_window(struct rtb_window *, int x, int y);
  */
 int64_t rtb_mouse_double_click_interval(struct rtb_window *);
 
+/**
+ * called whenever the window goes from not wanting a frame to wanting
+ * one (see rtb_window_wants_frame()). the platform should arrange for
+ * rtb_window_draw() to be called at the next refresh.
+ *
+ * can be called from any thread, locked or not, and before the event
+ * loop has been initialised.
+ */
+void rtb__platform_request_frame(struct rtb_window *);
+
 void rtb__platform_set_cursor(struct rtb_window *, struct rtb_mouse *,
 		rtb_mouse_cursor_t cursor);
 void rtb_mouse_pointer_warp(struct rtb_window *, int x, int y);
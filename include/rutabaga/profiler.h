@@ -0,0 +1,167 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+
+/**
+ * the profiler splits each frame into zones and records how long was
+ * spent in each, both on the CPU (uv_hrtime()) and, for the zones which
+ * submit GL work, on the GPU (GL_TIMESTAMP queries).
+ *
+ * times are exclusive: a surface drawn inside of another surface counts
+ * towards the SURFACE zone once, and the outer one's time doesn't
+ * include it. the zones of a frame add up to the frame's total.
+ *
+ * GPU results are read back a few frames late so that we never stall on
+ * them. until they arrive, a frame's gpu_valid is 0.
+ */
+
+/* how many frames are kept around for rtb_profiler_get_frame() */
+#define RTB_PROFILER_HISTORY   128
+
+/* how many frames of GPU queries can be in flight at once */
+#define RTB_PROFILER_LATENCY   4
+
+/* GPU-timed zones per frame, anything past this is timed on the CPU
+ * only. */
+#define RTB_PROFILER_MAX_QUERIES 64
+
+/* nesting past this is folded into the innermost zone we kept */
+#define RTB_PROFILER_MAX_DEPTH 32
+
+typedef enum {
+	/* whatever rtb_window_draw() does outside of the other zones */
+	RTB_PROFILE_FRAME = 0,
+	RTB_PROFILE_SURFACE,
+	RTB_PROFILE_BLIT,
+
+	/* CPU only. stylequads are batched up and drawn by the surface, so
+	 * there's no GPU time to pin on a single element. only recorded
+	 * with RTB_PROFILER_ELEMENTS set. */
+	RTB_PROFILE_ELEMENT,
+
+	/* CPU only. reflows and restyles between frames are counted
+	 * towards the next one. */
+	RTB_PROFILE_REFLOW,
+	RTB_PROFILE_RESTYLE,
+
+	RTB_PROFILE_ZONE_COUNT
+} rtb_profile_zone_t;
+
+typedef enum {
+	RTB_PROFILER_ELEMENTS = 1 << 0
+} rtb_profiler_flags_t;
+
+struct rtb_profiler;
+
+typedef void (*rtb_profiler_frame_cb_t)(struct rtb_profiler *, void *ctx);
+
+struct rtb_profile_times {
+	uint64_t cpu_ns;
+	uint64_t gpu_ns;
+	unsigned int count;
+};
+
+struct rtb_profile_frame {
+	uint64_t serial;
+
+	/* rtb_window_draw() from start to finish */
+	uint64_t cpu_ns;
+	uint64_t gpu_ns;
+	int gpu_valid;
+
+	struct rtb_profile_times zones[RTB_PROFILE_ZONE_COUNT];
+};
+
+struct rtb_profiler {
+	int enabled;
+	unsigned int flags;
+	int have_timer_query;
+
+	/* called at the start of each profiled frame, before anything is
+	 * drawn, once whatever GPU results have come in are filled in. */
+	rtb_profiler_frame_cb_t frame_cb;
+	void *frame_ctx;
+
+	/* serial of the frame being recorded */
+	uint64_t serial;
+	int in_frame;
+
+	struct rtb_profile_frame current;
+	struct rtb_profile_frame frames[RTB_PROFILER_HISTORY];
+
+	struct {
+		struct {
+			rtb_profile_zone_t zone;
+			uint64_t begin;
+			uint64_t children;
+
+			/* index into the current slot's zones, or -1 if this
+			 * one isn't being timed on the GPU */
+			int gpu;
+		} entries[RTB_PROFILER_MAX_DEPTH];
+
+		int depth;
+		int overflow;
+	} stack;
+
+	struct rtb_profiler_slot {
+		uint64_t serial;
+		int pending;
+
+		int nzones;
+		struct {
+			rtb_profile_zone_t zone;
+			int parent;
+		} zones[RTB_PROFILER_MAX_QUERIES];
+
+		/* a begin and end timestamp for each zone */
+		GLuint queries[RTB_PROFILER_MAX_QUERIES * 2];
+	} slots[RTB_PROFILER_LATENCY];
+};
+
+void rtb_profiler_begin_frame(struct rtb_profiler *);
+void rtb_profiler_end_frame(struct rtb_profiler *);
+
+/* zones have to be ended in the opposite order they were begun in. both
+ * are no-ops while the profiler is disabled. */
+void rtb_profiler_begin(struct rtb_profiler *, rtb_profile_zone_t);
+void rtb_profiler_end(struct rtb_profiler *, rtb_profile_zone_t);
+
+/* returns the frame recorded `ago` frames before the most recent one, or
+ * NULL if it's no longer (or not yet) in the history. */
+const struct rtb_profile_frame *rtb_profiler_get_frame(
+		struct rtb_profiler *, unsigned int ago);
+
+const char *rtb_profiler_zone_name(rtb_profile_zone_t);
+
+void rtb_profiler_enable(struct rtb_profiler *, int enabled);
+void rtb_profiler_set_flags(struct rtb_profiler *, unsigned int flags);
+
+int rtb_profiler_init(struct rtb_profiler *);
+void rtb_profiler_fini(struct rtb_profiler *);
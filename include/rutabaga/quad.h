@@ -34,6 +34,9 @@
 struct rtb_quad {
 	GLuint tex_coords;
 	GLuint vertices;
+
+	/* captures both of the above, so drawing is just a bind. */
+	GLuint vao;
 };
 
 void rtb_quad_set_tex_coords(struct rtb_quad *, struct rtb_rect *from);
@@ -0,0 +1,106 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+
+/**
+ * a shadow copy of the bits of GL state that the renderer changes all the
+ * time, so that setting something to the value it already has costs us a
+ * comparison instead of a trip through the driver.
+ *
+ * the shadow is only trusted between rtb_render_state_begin_frame() and
+ * the end of the frame. anything that touches this state behind our back
+ * during a frame has to call rtb_render_state_invalidate().
+ */
+
+#define RTB_RENDER_STATE_TEXTURE_UNITS 2
+
+struct rtb_render_state {
+	GLuint program;
+	GLuint framebuffer;
+	GLuint frame_uniforms;
+
+	struct {
+		GLint x, y;
+		GLsizei w, h;
+	} viewport, scissor;
+
+	GLint scissor_test;
+
+	struct {
+		GLenum src, dst;
+	} blend;
+
+	struct {
+		GLenum target;
+		GLuint texture;
+	} textures[RTB_RENDER_STATE_TEXTURE_UNITS];
+
+	/* whether the bound program's modelview has been set to something
+	 * other than the identity. */
+	int modelview_dirty;
+
+	/* counted since the last rtb_render_state_begin_frame() */
+	struct {
+		unsigned int issued;
+		unsigned int elided;
+
+		/* filled in by surfaces as they redraw */
+		unsigned long repainted_pixels;
+		unsigned int repainted_elements;
+	} stats;
+};
+
+void rtb_render_state_invalidate(struct rtb_render_state *);
+void rtb_render_state_begin_frame(struct rtb_render_state *);
+
+/* the setters return 1 if they actually touched GL, 0 if the call was
+ * elided because the state was already what was asked for. */
+
+int rtb_render_state_use_program(struct rtb_render_state *, GLuint program);
+int rtb_render_state_bind_frame_uniforms(struct rtb_render_state *,
+		GLuint buffer);
+
+int rtb_render_state_bind_framebuffer(struct rtb_render_state *,
+		GLuint framebuffer);
+GLuint rtb_render_state_get_framebuffer(struct rtb_render_state *);
+
+int rtb_render_state_viewport(struct rtb_render_state *,
+		GLint x, GLint y, GLsizei w, GLsizei h);
+void rtb_render_state_get_viewport(struct rtb_render_state *,
+		GLint viewport[4]);
+
+int rtb_render_state_scissor(struct rtb_render_state *,
+		GLint x, GLint y, GLsizei w, GLsizei h);
+int rtb_render_state_scissor_test(struct rtb_render_state *, int enable);
+
+int rtb_render_state_blend_func(struct rtb_render_state *,
+		GLenum src, GLenum dst);
+
+int rtb_render_state_bind_texture(struct rtb_render_state *,
+		GLuint unit, GLenum target, GLuint texture);
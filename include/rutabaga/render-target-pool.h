@@ -0,0 +1,84 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <rutabaga/types.h>
+
+#include "bsd/queue.h"
+
+/**
+ * surfaces draw into colour targets borrowed from a per-window pool, so
+ * that resizing one doesn't mean reallocating video memory every step of
+ * the way. targets come in size classes and a surface only uses the
+ * bottom-left corner of whatever it's handed.
+ */
+
+/* size classes go 64, 96, 128, 192, 256, 384... in each dimension */
+#define RTB_RENDER_TARGET_MIN_SIZE 64
+
+/* idle targets get freed, least recently used first, whenever the pool
+ * as a whole is over this many bytes. */
+#define RTB_RENDER_TARGET_POOL_BUDGET (64 * 1024 * 1024)
+
+struct rtb_render_target_pool;
+
+struct rtb_render_target {
+	GLuint texture;
+	GLuint fbo;
+
+	/* allocated size, which is a size class. */
+	int w, h;
+
+	/* NULL once the pool has gone away. */
+	struct rtb_render_target_pool *pool;
+	TAILQ_ENTRY(rtb_render_target) entry;
+};
+
+TAILQ_HEAD(rtb_render_targets, rtb_render_target);
+
+struct rtb_render_target_pool {
+	/* idle targets are kept most recently released first. */
+	struct rtb_render_targets idle;
+	struct rtb_render_targets live;
+
+	size_t bytes;
+	size_t budget;
+};
+
+/* returns NULL if nothing could be allocated. */
+struct rtb_render_target *rtb_render_target_acquire(
+		struct rtb_render_target_pool *, int w, int h);
+void rtb_render_target_release(struct rtb_render_target *);
+
+/* whether a target is still a sensible fit for a surface of w * h, or
+ * whether it should be traded for another. */
+int rtb_render_target_fits(const struct rtb_render_target *, int w, int h);
+
+int rtb_render_target_pool_init(struct rtb_render_target_pool *);
+void rtb_render_target_pool_fini(struct rtb_render_target_pool *);
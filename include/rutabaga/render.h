@@ -27,6 +27,8 @@
 #pragma once
 
 struct rtb_render_context;
+struct rtb_stylequad_batch;
+struct rtb_display_list;
 
 #include <rutabaga/types.h>
 #include <rutabaga/element.h>
@@ -41,6 +43,29 @@ struct rtb_render_context {
 	const struct rtb_shader *shader;
 
 	mat4 projection;
+
+	/* uniform buffer backing the shaders' rtb_frame block */
+	GLuint frame_uniforms;
+
+	/* what rtb_render_clear() clears to */
+	GLfloat clear_color[4];
+
+	/* non-NULL while the owning surface is drawing its children, in
+	 * which case stylequads are queued here instead of drawn. */
+	struct rtb_stylequad_batch *batch;
+
+	/* the display list of the element being drawn, if it's being
+	 * recorded. */
+	struct rtb_display_list *recording;
+
+	/* non-NULL while the owning surface is repainting a damaged region,
+	 * in window coordinates. nothing outside of it gets drawn. */
+	const struct rtb_rect *clip;
+
+	/* the element whose scissor and blend state we've been asked for,
+	 * and whether the GL state currently disagrees with it. */
+	struct rtb_element *element;
+	int element_state_stale;
 };
 
 struct rtb_style_property_definition;
@@ -62,6 +87,7 @@ void rtb_render_quad_outline(struct rtb_render_context *, struct rtb_quad *);
 void rtb_render_quad(struct rtb_render_context *, struct rtb_quad *);
 void rtb_render_clear(struct rtb_element *);
 
+void rtb_render_flush(struct rtb_render_context *);
 void rtb_render_use_shader(struct rtb_render_context *, const struct rtb_shader *);
 void rtb_render_reset(struct rtb_element *);
 void rtb_render_push(struct rtb_element *);
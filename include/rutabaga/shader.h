@@ -30,6 +30,18 @@
 
 #define RTB_SHADER(x) RTB_UPCAST(x, rtb_shader)
 
+/* shaders that declare `uniform rtb_frame { mat4 projection; };` get it
+ * hooked up to this binding point, which each render context fills from
+ * a uniform buffer. */
+#define RTB_SHADER_FRAME_BLOCK    "rtb_frame"
+#define RTB_SHADER_FRAME_UNIFORMS 0
+
+/* the `vertex` and `tex_coord` attributes are bound to these locations in
+ * every program, so a vertex array object can be built once and drawn
+ * with any shader. */
+#define RTB_SHADER_ATTRIB_VERTEX    0
+#define RTB_SHADER_ATTRIB_TEX_COORD 1
+
 struct rtb_shader_locations {
 	const char *modelview;
 	const char *projection;
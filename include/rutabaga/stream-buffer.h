@@ -0,0 +1,72 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+
+/**
+ * the stream buffer is a window-wide ring that geometry only needed for a
+ * single draw gets copied into, instead of every widget reallocating GL
+ * buffers of its own each frame.
+ *
+ * the ring is split into segments. leaving a segment puts a fence in
+ * after it, and coming back around to it checks that the GPU is done with
+ * it. if it isn't, the buffer is orphaned rather than waited on.
+ */
+
+#define RTB_STREAM_BUFFER_SIZE     (1024 * 1024)
+#define RTB_STREAM_BUFFER_SEGMENTS 4
+
+/* allocations start on multiples of this */
+#define RTB_STREAM_BUFFER_ALIGNMENT 16
+
+struct rtb_stream_buffer {
+	GLuint vbo;
+
+	GLintptr head;
+	int segment;
+	GLsync fences[RTB_STREAM_BUFFER_SEGMENTS];
+
+	/* running totals, reset by whoever cares to look at them */
+	struct {
+		unsigned int uploads;
+		unsigned int orphans;
+		size_t bytes;
+	} stats;
+};
+
+/* copies `size` bytes into the ring and returns the offset they landed at
+ * in self->vbo, which is left bound to GL_ARRAY_BUFFER. whatever was
+ * uploaded is good until the next upload wraps back around to it, so
+ * it has to be drawn from straight away.
+ *
+ * returns -1 if it didn't work out. */
+GLintptr rtb_stream_buffer_upload(struct rtb_stream_buffer *,
+		const void *data, GLsizeiptr size);
+
+int rtb_stream_buffer_init(struct rtb_stream_buffer *);
+void rtb_stream_buffer_fini(struct rtb_stream_buffer *);
@@ -114,6 +114,62 @@ struct rtb_style {
 	/* private ********************************/
 	struct rtb_style *inherit_from;
 	struct rtb_type_atom_descriptor *resolved_type;
+
+	/* computed styles, filled in by rtb_style_resolve_list(). one per
+	 * element state, indexed by property ID, with inheritance and the
+	 * state fallbacks already applied. states that come out identical
+	 * share a pointer. */
+	const struct rtb_style_property_definition
+		**computed[RTB_ELEM_STATE_COUNT];
+	const struct rtb_style_property_definition **computed_storage;
+	size_t nprops;
+};
+
+/**
+ * property IDs
+ *
+ * every (name, type) pair that appears in a window's stylesheet is
+ * interned to a small integer when the stylesheet is resolved, so that
+ * looking a property up is an array index. the string-based queries hash
+ * the name first. the properties the core uses itself get fixed IDs, so
+ * they don't even need that.
+ */
+
+typedef int rtb_style_prop_id_t;
+
+#define RTB_STYLE_PROP_ID_NONE ((rtb_style_prop_id_t) -1)
+
+enum {
+	RTB_STYLE_PROP_ID_MIN_WIDTH = 0,      /* float */
+	RTB_STYLE_PROP_ID_MIN_HEIGHT,         /* float */
+	RTB_STYLE_PROP_ID_COLOR,              /* color */
+	RTB_STYLE_PROP_ID_BACKGROUND_COLOR,   /* color */
+	RTB_STYLE_PROP_ID_BORDER_COLOR,       /* color */
+	RTB_STYLE_PROP_ID_BACKGROUND_IMAGE,   /* texture */
+	RTB_STYLE_PROP_ID_BORDER_IMAGE,       /* texture */
+
+	RTB_STYLE_PROP_ID_BUILTIN_COUNT
+};
+
+struct rtb_style_prop_key {
+	char *name;
+	rtb_style_prop_type_t type;
+
+	/* set once anything has looked this property up through
+	 * rtb_style_query_prop_in_tree(), meaning that descendants can
+	 * depend on it. */
+	int inherited;
+};
+
+struct rtb_style_prop_table {
+	/* indexed by property ID */
+	struct rtb_style_prop_key *keys;
+	size_t nkeys;
+	size_t keys_capacity;
+
+	/* open addressing, a power of two in size */
+	rtb_style_prop_id_t *buckets;
+	size_t nbuckets;
 };
 
 struct rtb_style_data {
@@ -128,12 +184,25 @@ struct rtb_style_data {
 const struct rtb_style_property_definition *rtb_style_query_prop(
 		struct rtb_element *elem, const char *property_name,
 		rtb_style_prop_type_t type, int should_return_fallback);
+const struct rtb_style_property_definition *rtb_style_query_prop_id(
+		struct rtb_element *elem, rtb_style_prop_id_t id,
+		rtb_style_prop_type_t type, int should_return_fallback);
 const struct rtb_style_property_definition *rtb_style_query_prop_in_tree(
 		struct rtb_element *leaf, const char *property_name,
 		rtb_style_prop_type_t type, int should_return_fallback);
 int rtb_style_elem_has_properties_for_state(struct rtb_element *elem,
 		rtb_elem_state_t state);
 
+/* nonzero if an element of this style looks different in the two states,
+ * in which case changing between them needs a restyle. */
+int rtb_style_states_differ(struct rtb_style *,
+		rtb_elem_state_t a, rtb_elem_state_t b);
+
+/* nonzero if any property that descendants inherit differs between the
+ * two states, in which case they need a restyle too. */
+int rtb_style_inherited_differ(struct rtb_window *, struct rtb_style *,
+		rtb_elem_state_t a, rtb_elem_state_t b);
+
 void rtb_style_apply_to_tree(struct rtb_element *root,
 		struct rtb_style *style_list);
 struct rtb_style *rtb_style_for_element(struct rtb_element *elem,
@@ -141,6 +210,16 @@ struct rtb_style *rtb_style_for_element(struct rtb_element *elem,
 
 int rtb_style_resolve_list(struct rtb_window *,
 		struct rtb_style *style_list);
+void rtb_style_unresolve_list(struct rtb_style *style_list);
+
+/* interns the pair if it hasn't been seen yet, so the ID can be kept
+ * around. IDs stay the same for as long as the window is open. returns
+ * RTB_STYLE_PROP_ID_NONE if allocating failed. */
+rtb_style_prop_id_t rtb_style_prop_id(struct rtb_window *,
+		const char *property_name, rtb_style_prop_type_t type);
+
+int rtb_style_prop_table_init(struct rtb_style_prop_table *);
+void rtb_style_prop_table_fini(struct rtb_style_prop_table *);
 
 struct rtb_font *rtb_style_get_font_for_def(struct rtb_window *,
 		const struct rtb_style_font_definition *);
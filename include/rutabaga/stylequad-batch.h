@@ -0,0 +1,142 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+#include <rutabaga/geometry.h>
+#include <rutabaga/mat4.h>
+#include <rutabaga/stylequad.h>
+
+#include "wwrl/vector.h"
+
+/**
+ * every instance is stored as RTB_STYLEQUAD_BATCH_TEXELS RGBA32F texels in
+ * a buffer texture, which the stylequad-batch vertex shader pulls apart with
+ * texelFetch(). if you change the layout here, change it there as well.
+ */
+
+#define RTB_STYLEQUAD_BATCH_TEXELS 7
+
+/* keeps a single flush comfortably under the minimum
+ * GL_MAX_TEXTURE_BUFFER_SIZE that GL 3.2 guarantees (65536 texels). */
+#define RTB_STYLEQUAD_BATCH_MAX_INSTANCES 8192
+
+/* how many runs back we'll look for one we can merge into. */
+#define RTB_STYLEQUAD_BATCH_LOOKBACK 8
+
+typedef enum {
+	RTB_STYLEQUAD_BATCH_SOLID,
+	RTB_STYLEQUAD_BATCH_BORDER,
+	RTB_STYLEQUAD_BATCH_OUTLINE
+} rtb_stylequad_batch_kind_t;
+
+struct rtb_stylequad_instance {
+	/* center.x, center.y, half width, half height */
+	GLfloat geometry[4];
+	GLfloat color[4];
+
+	/* upper-left 2x2 of the modelview, column-major */
+	GLfloat rotation[4];
+
+	/* x, y, x2, y2, in the same space as the projection */
+	GLfloat clip[4];
+
+	/* left, top, right, bottom. in pixels... */
+	GLfloat border[4];
+	/* ...and normalised to the texture. */
+	GLfloat tex_border[4];
+
+	/* where the image sits in its (possibly atlas) texture:
+	 * u, v, width, height, all normalised. */
+	GLfloat tex_rect[4];
+};
+
+struct rtb_stylequad_batch_run {
+	rtb_stylequad_batch_kind_t kind;
+	GLuint texture;
+	struct rtb_size texture_size;
+
+	struct rtb_rect bounds;
+
+	unsigned int first;
+	unsigned int count;
+};
+
+struct rtb_stylequad_batch_entry {
+	struct rtb_stylequad_instance instance;
+	unsigned int run;
+};
+
+struct rtb_stylequad_batch {
+	VECTOR(rtb_stylequad_batch_entries,
+		struct rtb_stylequad_batch_entry) entries;
+	VECTOR(rtb_stylequad_batch_runs,
+		struct rtb_stylequad_batch_run) runs;
+
+	/* scratch space for laying the instances out run-by-run */
+	struct rtb_stylequad_instance *upload;
+	size_t upload_capacity;
+
+	GLuint corners;
+	GLuint corners_vao;
+	GLuint instance_buffer;
+	GLuint instance_texture;
+
+	/* cached from the last shader we flushed with */
+	const struct rtb_shader *shader;
+	struct {
+		GLint instances;
+		GLint instance_base;
+		GLint sampler;
+	} loc;
+
+	/* running totals, reset by whoever cares to look at them */
+	struct {
+		unsigned int instances;
+		unsigned int draw_calls;
+	} stats;
+};
+
+void rtb_stylequad_batch_add(struct rtb_stylequad_batch *,
+		struct rtb_render_context *, const struct rtb_stylequad *,
+		const struct rtb_element *clip_to, const mat4 *modelview,
+		rtb_stylequad_draw_mode_t);
+void rtb_stylequad_batch_push(struct rtb_stylequad_batch *,
+		struct rtb_render_context *, const struct rtb_stylequad_instance *,
+		const struct rtb_rect *bounds, rtb_stylequad_batch_kind_t,
+		GLuint texture, const struct rtb_size *texture_size);
+void rtb_stylequad_batch_flush(struct rtb_stylequad_batch *,
+		struct rtb_render_context *);
+
+static inline int
+rtb_stylequad_batch_is_empty(const struct rtb_stylequad_batch *self)
+{
+	return !self->entries.size;
+}
+
+int rtb_stylequad_batch_init(struct rtb_stylequad_batch *);
+void rtb_stylequad_batch_fini(struct rtb_stylequad_batch *);
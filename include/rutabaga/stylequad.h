@@ -31,6 +31,7 @@
 #include <rutabaga/shader.h>
 #include <rutabaga/quad.h>
 #include <rutabaga/mat4.h>
+#include <rutabaga/texture-cache.h>
 
 typedef enum {
 	RTB_STYLEQUAD_DRAW_BG_COLOR     = 0x01,
@@ -47,8 +48,10 @@ typedef enum {
 
 struct rtb_stylequad {
 	struct rtb_point offset;
+	struct rtb_size size;
 
 	GLuint vertices;
+	GLuint vao;
 
 	struct {
 		const struct rtb_rgb_color *bg_color;
@@ -57,8 +60,11 @@ struct rtb_stylequad {
 
 	struct rtb_stylequad_texture {
 		const struct rtb_style_texture_definition *definition;
-		GLuint gl_handle;
+		struct rtb_cached_texture *cached;
 		GLuint coords;
+
+		/* the stylequad's vertices plus these coords */
+		GLuint vao;
 	} border_image, background_image;
 };
 
@@ -74,8 +80,10 @@ void rtb_stylequad_draw_with_modelview(struct rtb_stylequad *,
 		rtb_stylequad_draw_mode_t);
 
 int rtb_stylequad_set_border_image(struct rtb_stylequad *,
+		struct rtb_texture_cache *,
 		const struct rtb_style_texture_definition *);
 int rtb_stylequad_set_background_image(struct rtb_stylequad *,
+		struct rtb_texture_cache *,
 		const struct rtb_style_texture_definition *);
 int rtb_stylequad_set_background_color(struct rtb_stylequad *,
 		const struct rtb_rgb_color *);
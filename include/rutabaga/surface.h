@@ -30,6 +30,8 @@
 #include <rutabaga/types.h>
 #include <rutabaga/element.h>
 #include <rutabaga/render.h>
+#include <rutabaga/render-target-pool.h>
+#include <rutabaga/stylequad-batch.h>
 #include <rutabaga/mat4.h>
 
 #define RTB_SURFACE(x) RTB_UPCAST(x, rtb_surface)
@@ -41,18 +43,50 @@ typedef enum {
 	RTB_SURFACE_INVALID
 } rtb_surface_state_t;
 
+typedef enum {
+	/* clear and redraw only the rects of dirty elements, and whatever
+	 * else overlaps them. */
+	RTB_SURFACE_REPAINT_DAMAGE,
+
+	/* redraw each dirty element's nearest clearable ancestor along with
+	 * everything underneath it. */
+	RTB_SURFACE_REPAINT_SUBTREE
+} rtb_surface_repaint_mode_t;
+
+/* past this many disjoint damaged regions, they get merged. */
+#define RTB_SURFACE_DAMAGE_REGIONS 8
+
 struct rtb_surface {
 	RTB_INHERIT(rtb_element);
 
 	/* private ********************************/
-	GLuint fbo;
-	GLuint texture;
+	/* borrowed from the window's pool. NULL until the first reflow, and
+	 * for as long as we're drawing in place. */
+	struct rtb_render_target *target;
 	struct rtb_quad quad;
 
 	rtb_surface_state_t surface_state;
+	rtb_surface_repaint_mode_t repaint_mode;
+
+	/* regions to repaint on the next rtb_surface_draw_children() on top
+	 * of the queued elements, in window coordinates. */
+	struct {
+		struct rtb_rect regions[RTB_SURFACE_DAMAGE_REGIONS];
+		int count;
+	} pending;
+
+	/* draw children straight into whichever framebuffer was bound when
+	 * drawing started, instead of into our own, and skip the blit. only
+	 * makes sense for a window whose back buffer keeps its contents. */
+	int draw_in_place;
+
+	/* bounding box of everything the last rtb_surface_draw_children()
+	 * touched, in window coordinates. */
+	struct rtb_rect damage;
 
 	struct rtb_render_tailq render_queue;
 	struct rtb_render_context render_ctx;
+	struct rtb_stylequad_batch batch;
 };
 
 int rtb_surface_is_dirty(struct rtb_surface *);
@@ -60,6 +94,7 @@ int rtb_surface_is_dirty(struct rtb_surface *);
 void rtb_surface_blit(struct rtb_surface *);
 void rtb_surface_draw_children(struct rtb_surface *);
 void rtb_surface_invalidate(struct rtb_surface *);
+void rtb_surface_add_damage(struct rtb_surface *, const struct rtb_rect *);
 
 int rtb_surface_init(struct rtb_surface *);
 void rtb_surface_fini(struct rtb_surface *);
@@ -0,0 +1,121 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+#include <rutabaga/geometry.h>
+#include <rutabaga/dict.h>
+
+#include "bsd/queue.h"
+#include "wwrl/vector.h"
+
+/**
+ * the texture cache hands out one GL texture per style asset, no matter how
+ * many elements are using it. small images are packed into shared atlas
+ * pages so that stylequads using different images can still end up in the
+ * same batched draw.
+ */
+
+#define RTB_TEXTURE_PAGE_SIZE 1024
+
+/* anything bigger than this in either dimension gets a texture of its own */
+#define RTB_TEXTURE_ATLAS_MAX_IMAGE 256
+
+/* pixels of replicated edge around each packed image, so that linear
+ * filtering at the edges doesn't pick up the neighbours. */
+#define RTB_TEXTURE_ATLAS_GUTTER 1
+
+typedef enum {
+	/* may be packed into a shared atlas page */
+	RTB_TEXTURE_CACHE_ATLAS   = 0x01,
+
+	/* these force a standalone texture */
+	RTB_TEXTURE_CACHE_NEAREST = 0x02,
+	RTB_TEXTURE_CACHE_REPEAT  = 0x04
+} rtb_texture_cache_flags_t;
+
+struct rtb_texture_shelf {
+	int y, h;
+	int free_x;
+};
+
+struct rtb_texture_page {
+	GLuint gl_handle;
+	unsigned int refcount;
+
+	/* packing is shelf-based. space is only reclaimed when the page
+	 * empties out entirely. */
+	int free_y;
+	VECTOR(rtb_texture_page_shelves, struct rtb_texture_shelf) shelves;
+
+	TAILQ_ENTRY(rtb_texture_page) page_entry;
+};
+
+struct rtb_cached_texture {
+	const struct rtb_style_texture_definition *definition;
+	rtb_texture_cache_flags_t flags;
+	unsigned int refcount;
+
+	GLuint gl_handle;
+
+	/* NULL if we've got gl_handle to ourselves */
+	struct rtb_texture_page *page;
+
+	/* where the image lives in gl_handle, normalised. */
+	struct rtb_rect uv;
+
+	struct rtb_texture_cache *cache;
+	NEDTRIE_ENTRY(rtb_cached_texture) trie_entry;
+};
+
+NEDTRIE_HEAD(rtb_texture_cache_trie, rtb_cached_texture);
+TAILQ_HEAD(rtb_texture_pages, rtb_texture_page);
+
+struct rtb_texture_cache {
+	struct rtb_texture_cache_trie textures;
+	struct rtb_texture_pages pages;
+};
+
+struct rtb_style_texture_definition;
+
+struct rtb_cached_texture *rtb_texture_cache_ref(struct rtb_texture_cache *,
+		const struct rtb_style_texture_definition *,
+		rtb_texture_cache_flags_t);
+void rtb_texture_cache_unref(struct rtb_cached_texture *);
+
+/* maps a normalised coordinate within the image to one within
+ * the texture it lives in. */
+static inline void
+rtb_cached_texture_map(const struct rtb_cached_texture *self,
+		GLfloat *u, GLfloat *v)
+{
+	*u = self->uv.x + (*u * self->uv.w);
+	*v = self->uv.y + (*v * self->uv.h);
+}
+
+int rtb_texture_cache_init(struct rtb_texture_cache *);
+void rtb_texture_cache_fini(struct rtb_texture_cache *);
@@ -34,6 +34,8 @@
 
 #include <rutabaga/widgets/label.h>
 
+#include "wwrl/vector.h"
+
 #define RTB_PATCHBAY(x) RTB_UPCAST(x, rtb_patchbay)
 #define RTB_PATCHBAY_NODE(x) RTB_UPCAST(x, rtb_patchbay_node)
 #define RTB_PATCHBAY_PORT(x) RTB_UPCAST(x, rtb_patchbay_port)
@@ -82,12 +84,18 @@ struct rtb_patchbay_patch {
 	TAILQ_ENTRY(rtb_patchbay_patch) to_patch;
 };
 
+/* laid out the way the patchbay-cable shader reads it */
+struct rtb_patchbay_cable {
+	GLfloat endpoints[4];
+	GLfloat color[4];
+};
+
 struct rtb_patchbay {
 	RTB_INHERIT(rtb_surface);
 
 	/* private ********************************/
-	GLuint bg_vbo[2];
-	GLuint bg_texture;
+	GLuint bg_vbo;
+	struct rtb_cached_texture *bg_texture;
 	struct rtb_point texture_offset;
 
 	TAILQ_HEAD(patchbay_patches, rtb_patchbay_patch) patches;
@@ -97,6 +105,23 @@ struct rtb_patchbay {
 
 		struct rtb_point cursor;
 	} patch_in_progress;
+
+	/* every cable is drawn with a single instanced draw. the instances
+	 * are only rebuilt when `dirty` is set, which happens whenever
+	 * patches, ports or the patch in progress change. */
+	struct {
+		GLuint corners;
+		GLuint vao;
+		GLuint buffer;
+		GLuint texture;
+
+		VECTOR(rtb_patchbay_cables, struct rtb_patchbay_cable) instances;
+		int dirty;
+
+		/* index of the cable following the mouse around, or -1. */
+		int in_progress;
+		int disconnecting;
+	} cables;
 };
 
 /**
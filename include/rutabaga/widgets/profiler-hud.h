@@ -0,0 +1,64 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/profiler.h>
+#include <rutabaga/text-object.h>
+
+#define RTB_PROFILER_HUD(x) RTB_UPCAST(x, rtb_profiler_hud)
+
+/**
+ * draws the window's recent frame times as a graph, one bar of CPU time
+ * per frame with the GPU time traced over it. turns the window's
+ * profiler on when it's attached.
+ */
+
+struct rtb_profiler_hud {
+	RTB_INHERIT(rtb_element);
+
+	/* frame time at the top of the graph */
+	float scale_ms;
+
+	/* frame time to draw a line across the graph at */
+	float budget_ms;
+
+	/* private ********************************/
+	struct rtb_font *font;
+	struct rtb_text_object *tobj;
+	const struct rtb_rgb_color *color;
+
+	/* cpu bars, then the budget line, then the gpu trace */
+	GLfloat graph[RTB_PROFILER_HISTORY * 3 + 2][2];
+};
+
+int rtb_profiler_hud_init(struct rtb_profiler_hud *);
+void rtb_profiler_hud_fini(struct rtb_profiler_hud *);
+
+struct rtb_profiler_hud *rtb_profiler_hud_new(void);
+void rtb_profiler_hud_free(struct rtb_profiler_hud *);
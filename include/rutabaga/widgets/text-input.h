@@ -49,7 +49,7 @@ struct rtb_text_input {
 	int label_offset;
 
 	struct rtb_quad bg_quad;
-	GLuint cursor_vbo;
+	GLfloat cursor_line[2][2];
 };
 
 int rtb_text_input_set_text(struct rtb_text_input *,
@@ -32,25 +32,67 @@
 #include <rutabaga/element.h>
 #include <rutabaga/shader.h>
 #include <rutabaga/surface.h>
+#include <rutabaga/render-state.h>
+#include <rutabaga/texture-cache.h>
+#include <rutabaga/render-target-pool.h>
+#include <rutabaga/stream-buffer.h>
+#include <rutabaga/profiler.h>
+#include <rutabaga/mutation-queue.h>
 #include <rutabaga/mouse.h>
 #include <rutabaga/event.h>
 #include <rutabaga/font-manager.h>
+#include <rutabaga/style.h>
 
 #define RTB_WINDOW(x) RTB_UPCAST(x, rtb_window)
 #define RTB_WINDOW_AS(x, type) RTB_DOWNCAST(x, type, rtb_window)
 
 #define RTB_WINDOW_EVENT(x) RTB_UPCAST(x, rtb_window_event)
 
+/* how many frames of damage we remember for buffer-age repaints */
+#define RTB_WINDOW_DAMAGE_HISTORY 4
+
+typedef enum {
+	/* draw into the window's own offscreen surface, then blit all of it
+	 * and present the whole window. works everywhere. */
+	RTB_PRESENT_FULL = 0,
+
+	/* draw straight into the back buffer. the platform reports how many
+	 * frames old its contents are before each frame, and we repaint
+	 * whatever's changed since. */
+	RTB_PRESENT_BUFFER_AGE,
+
+	/* draw straight into a back buffer that's never swapped, so it's
+	 * always current, and copy just the damaged region to the front. */
+	RTB_PRESENT_COPY_SUB_BUFFER
+} rtb_present_mode_t;
+
 struct rtb_window_event {
 	RTB_INHERIT(rtb_event);
 	struct rtb_window *window;
 };
 
+/**
+ * called once, at the start of the next frame. `frame_time` is when the
+ * frame is expected to be shown, in nanoseconds on uv_hrtime()'s clock.
+ * animations should request another frame from in here for as long as
+ * they're running.
+ */
+typedef void (*rtb_frame_cb_t)(struct rtb_window *,
+		uint64_t frame_time, void *ctx);
+
+struct rtb_frame_callback {
+	rtb_frame_cb_t cb;
+	void *ctx;
+};
+
+VECTOR(rtb_frame_callbacks, struct rtb_frame_callback);
+
 struct rtb_window_local_storage {
 	struct {
 		struct rtb_shader dfault;
 		struct rtb_shader surface;
 		struct rtb_shader stylequad;
+		struct rtb_shader stylequad_batch;
 	} shader;
 
 	struct {
@@ -65,6 +107,12 @@ struct rtb_window_local_storage {
 			GLuint outline;
 		} quad;
 	} ibo;
+
+	struct rtb_texture_cache textures;
+	struct rtb_render_target_pool targets;
+	struct rtb_stream_buffer stream;
+	struct rtb_render_state state;
+	struct rtb_profiler profiler;
 };
 
 struct rtb_window {
@@ -76,6 +124,7 @@ struct rtb_window {
 
 	struct rtb_style *style_list;
 	struct rtb_font *style_fonts;
+	struct rtb_style_prop_table style_props;
 
 	/* private ********************************/
 	int finished_initialising;
@@ -93,6 +142,40 @@ struct rtb_window {
 	int dirty;
 	uv_mutex_t lock;
 
+	struct {
+		/* set by the platform when the window is opened */
+		rtb_present_mode_t mode;
+
+		/* what frames get drawn into. 0, the window system's own,
+		 * unless the platform doesn't have one. */
+		GLuint framebuffer;
+
+		/* set by the platform before each rtb_window_draw(), for
+		 * RTB_PRESENT_BUFFER_AGE. 0 means the contents are unknown. */
+		int buffer_age;
+
+		/* what the platform needs to put on screen after a successful
+		 * rtb_window_draw(), in window coordinates. */
+		struct rtb_rect damage;
+
+		/* damage of the previous frames, most recent first */
+		struct rtb_rect history[RTB_WINDOW_DAMAGE_HISTORY];
+
+		int exposed;
+
+		/* set by the platform before each rtb_window_draw(), on
+		 * uv_hrtime()'s clock. 0 means now. */
+		uint64_t frame_time;
+	} present;
+
+	struct {
+		struct rtb_frame_callbacks pending;
+		struct rtb_frame_callbacks running;
+	} frame_callbacks;
+
+	/* posted to from any thread, applied at the start of each frame */
+	struct rtb_mutation_queue mutations;
+
 	struct rtb_mouse mouse;
 	struct rtb_element *focus;
 };
@@ -109,11 +192,48 @@ int rtb_window_draw(struct rtb_window *, int force_redraw);
 void rtb_window_focus_element(struct rtb_window *,
 		struct rtb_element *focused);
 
+/**
+ * frame scheduling. the platform only draws frames while the window
+ * wants them: while it's dirty, has frame callbacks pending, or has a
+ * handler for RTB_FRAME_START or RTB_FRAME_END registered on it. windows
+ * that are fully obscured want nothing, except to have posted mutations
+ * applied (see mutation-queue.h).
+ */
+int rtb_window_wants_frame(struct rtb_window *);
+
+void rtb_window_request_frame(struct rtb_window *,
+		rtb_frame_cb_t cb, void *ctx);
+void rtb_window_cancel_frame(struct rtb_window *,
+		rtb_frame_cb_t cb, void *ctx);
+
+/**
+ * threading. everything that touches the element tree or GL has to hold
+ * the window lock.
+ *
+ * while the event loop is running, its thread owns the GL context and
+ * keeps it current, so locking from there (which is what the platform
+ * does around every event and frame) costs a mutex and nothing else.
+ *
+ * other threads can still take the lock. they block until the loop
+ * thread hands the context over, have it current until they unlock, and
+ * give it back after. that's a pair of context switches each time, so
+ * anything more frequent than the odd notification should go through
+ * rtb_window_post() and friends instead.
+ *
+ * outside of the event loop, the context is made current on every lock
+ * and released on every unlock, by whichever thread it is.
+ */
 void rtb_window_lock(struct rtb_window *);
 void rtb_window_unlock(struct rtb_window *);
 
 void rtb_window_reinit(struct rtb_window *);
 
+/**
+ * for the platform to call when the windowing system has lost what we
+ * last presented. the next frame presents the whole window.
+ */
+void rtb_window_mark_exposed(struct rtb_window *);
+
 struct rtb_window *rtb_window_open_under(struct rutabaga *,
 		intptr_t parent, int width, int height, const char *title);
 struct rtb_window *rtb_window_open(struct rutabaga *,
@@ -134,6 +134,8 @@ alloc_type_descriptor(uint_t hash, const char *type_name, size_t len,
 	name_start = need;
 	need += len + 1;
 	ret = calloc(1, need);
+	if (!ret)
+		return NULL;
 
 	ret->dict_entry.hash = hash;
 	ret->ref_count = 0;
@@ -151,6 +153,7 @@ alloc_type_descriptor(uint_t hash, const char *type_name, size_t len,
 	}
 
 	ret->super[supertypes] = NULL;
+	ret->depth = supertypes;
 
 	return ret;
 }
@@ -173,20 +176,23 @@ rtb_type_lookup(struct rtb_window *win, const char *type_name)
 }
 
 int
-rtb_is_type(struct rtb_type_atom_descriptor *desc,
-		struct rtb_type_atom *atom)
+rtb_type_is_a(struct rtb_type_atom_descriptor *type,
+		struct rtb_type_atom_descriptor *super)
 {
-	struct rtb_type_atom_descriptor *type_a, *type_b;
+	if (type == super)
+		return 1;
 
-	type_a = desc;
-	type_b = atom->type;
+	if (!type || !super || super->depth >= type->depth)
+		return 0;
 
-	do {
-		if (type_a == type_b)
-			return 1;
-	} while ((type_b = type_b->super[0]));
+	return type->super[type->depth - 1 - super->depth] == super;
+}
 
-	return 0;
+int
+rtb_is_type(struct rtb_type_atom_descriptor *desc,
+		struct rtb_type_atom *atom)
+{
+	return rtb_type_is_a(atom->type, desc);
 }
 
 struct rtb_type_atom_descriptor *
@@ -217,6 +223,30 @@ rtb_type_ref(struct rtb_window *win, struct rtb_type_atom_descriptor *super,
 	return type;
 }
 
+struct rtb_type_atom_descriptor *
+rtb_type_ref_class(struct rtb_window *win,
+		struct rtb_type_atom_descriptor *super, struct rtb_type_class *cls)
+{
+	struct rtb_type_atom_descriptor *type = cls->desc;
+
+	/* the cached descriptor belongs to whichever rutabaga instance
+	 * looked it up first. */
+	if (type && type->dict == &win->rtb->atoms.type) {
+		type->ref_count++;
+		return type;
+	}
+
+	if (!(type = rtb_type_ref(win, super, cls->name)))
+		return NULL;
+
+	if (!cls->desc) {
+		cls->desc = type;
+		type->cls = cls;
+	}
+
+	return type;
+}
+
 int
 rtb_type_unref(struct rtb_type_atom_descriptor *type)
 {
@@ -226,6 +256,9 @@ rtb_type_unref(struct rtb_type_atom_descriptor *type)
 	rtb_type_unref(type->super[0]);
 
 	if (!--type->ref_count) {
+		if (type->cls && type->cls->desc == type)
+			type->cls->desc = NULL;
+
 		NEDTRIE_REMOVE(rtb_atom_dict, type->dict, RTB_ATOM_DESCRIPTOR(type));
 		free(type);
 		return 0;
@@ -0,0 +1,261 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/child-index.h>
+
+/**
+ * building
+ */
+
+static int
+hit_testable(struct rtb_element *elem)
+{
+	return elem->visibility != RTB_FULLY_OBSCURED
+		&& !rtb_rect_is_empty(&elem->rect);
+}
+
+static int
+grow(void **buf, size_t *have, size_t need, size_t size)
+{
+	void *n;
+
+	if (*have >= need)
+		return 0;
+
+	if (!(n = realloc(*buf, need * size)))
+		return -1;
+
+	*buf = n;
+	*have = need;
+	return 0;
+}
+
+static int
+collect(struct rtb_child_index *self, struct rtb_element *parent)
+{
+	struct rtb_element *iter;
+	size_t n = 0;
+
+	TAILQ_FOREACH(iter, &parent->children, child)
+		n++;
+
+	if (grow((void **) &self->order, &self->capacity.order, n,
+				sizeof(*self->order)))
+		return -1;
+
+	n = 0;
+
+	/* later children sit on top of earlier ones. */
+	TAILQ_FOREACH_REVERSE(iter, &parent->children, children, child) {
+		if (!hit_testable(iter))
+			continue;
+
+		if (!n)
+			self->bounds = iter->rect;
+		else {
+			self->bounds.x  = fminf(self->bounds.x,  iter->x);
+			self->bounds.y  = fminf(self->bounds.y,  iter->y);
+			self->bounds.x2 = fmaxf(self->bounds.x2, iter->x2);
+			self->bounds.y2 = fmaxf(self->bounds.y2, iter->y2);
+		}
+
+		self->order[n++] = iter;
+	}
+
+	return n;
+}
+
+static int
+clamp_cell(GLfloat v, GLfloat origin, GLfloat cell, int ncells)
+{
+	int c = (int) ((v - origin) / cell);
+
+	if (c < 0)
+		return 0;
+	else if (c >= ncells)
+		return ncells - 1;
+	return c;
+}
+
+#define CELL_RANGE(self, elem, c0, c1, r0, r1) do {                       \
+	c0 = clamp_cell((elem)->x,  (self)->bounds.x, (self)->cell_w,         \
+			(self)->cols);                                                \
+	c1 = clamp_cell((elem)->x2, (self)->bounds.x, (self)->cell_w,         \
+			(self)->cols);                                                \
+	r0 = clamp_cell((elem)->y,  (self)->bounds.y, (self)->cell_h,         \
+			(self)->rows);                                                \
+	r1 = clamp_cell((elem)->y2, (self)->bounds.y, (self)->cell_h,         \
+			(self)->rows);                                                \
+} while (0)
+
+static int
+rebuild(struct rtb_child_index *self, struct rtb_element *parent)
+{
+	struct rtb_element *elem;
+	int n, i, c, r, c0, c1, r0, r1, side;
+	size_t ncells, nentries;
+
+	if ((n = collect(self, parent)) < 0)
+		return -1;
+
+	self->stale = 0;
+	self->linear = (n < RTB_CHILD_INDEX_MIN_CHILDREN);
+
+	if (self->linear)
+		return 0;
+
+	rtb_rect_update_size_from_points(&self->bounds);
+
+	/* around one child per cell, give or take overlap. */
+	side = (int) ceilf(sqrtf((float) n));
+	if (side > RTB_CHILD_INDEX_MAX_SIDE)
+		side = RTB_CHILD_INDEX_MAX_SIDE;
+
+	self->cols = self->rows = side;
+	self->cell_w = fmaxf(self->bounds.w / side, 1.f);
+	self->cell_h = fmaxf(self->bounds.h / side, 1.f);
+
+	ncells = side * side;
+
+	if (grow((void **) &self->cells, &self->capacity.cells, ncells + 1,
+				sizeof(*self->cells))
+			|| grow((void **) &self->fill, &self->capacity.fill, ncells,
+				sizeof(*self->fill)))
+		goto err;
+
+	memset(self->cells, 0, (ncells + 1) * sizeof(*self->cells));
+
+	/* counting sort: first how many land in each cell... */
+	for (i = 0; i < n; i++) {
+		CELL_RANGE(self, self->order[i], c0, c1, r0, r1);
+
+		for (r = r0; r <= r1; r++)
+			for (c = c0; c <= c1; c++)
+				self->cells[r * side + c + 1]++;
+	}
+
+	for (i = 0; i < (int) ncells; i++) {
+		self->cells[i + 1] += self->cells[i];
+		self->fill[i] = self->cells[i];
+	}
+
+	nentries = self->cells[ncells];
+	if (grow((void **) &self->entries, &self->capacity.entries, nentries,
+				sizeof(*self->entries)))
+		goto err;
+
+	/* ...then put them there, keeping them topmost first. */
+	for (i = 0; i < n; i++) {
+		elem = self->order[i];
+		CELL_RANGE(self, elem, c0, c1, r0, r1);
+
+		for (r = r0; r <= r1; r++)
+			for (c = c0; c <= c1; c++)
+				self->entries[self->fill[r * side + c]++] = elem;
+	}
+
+	return 0;
+
+err:
+	self->linear = 1;
+	return -1;
+}
+
+/**
+ * public API
+ */
+
+struct rtb_element *
+rtb_child_index_find(struct rtb_child_index *self,
+		struct rtb_element *parent, const struct rtb_point *pt)
+{
+	struct rtb_element *elem;
+	unsigned int i, end;
+	int cell;
+
+	if (self->stale)
+		rebuild(self, parent);
+
+	if (self->linear) {
+		TAILQ_FOREACH_REVERSE(elem, &parent->children, children, child)
+			if (RTB_POINT_IN_RECT(*pt, *elem)
+					&& elem->visibility != RTB_FULLY_OBSCURED)
+				return elem;
+
+		return NULL;
+	}
+
+	if (!RTB_POINT_IN_RECT(*pt, self->bounds))
+		return NULL;
+
+	cell = clamp_cell(pt->y, self->bounds.y, self->cell_h, self->rows)
+		* self->cols
+		+ clamp_cell(pt->x, self->bounds.x, self->cell_w, self->cols);
+
+	end = self->cells[cell + 1];
+
+	for (i = self->cells[cell]; i < end; i++) {
+		elem = self->entries[i];
+
+		if (RTB_POINT_IN_RECT(*pt, *elem))
+			return elem;
+	}
+
+	return NULL;
+}
+
+void
+rtb_child_index_invalidate(struct rtb_child_index *self)
+{
+	self->stale = 1;
+}
+
+struct rtb_child_index *
+rtb_child_index_new(void)
+{
+	struct rtb_child_index *self = calloc(1, sizeof(*self));
+
+	if (self)
+		self->stale = 1;
+
+	return self;
+}
+
+void
+rtb_child_index_free(struct rtb_child_index *self)
+{
+	free(self->cells);
+	free(self->fill);
+	free(self->entries);
+	free(self->order);
+	free(self);
+}
@@ -31,7 +31,9 @@
 #include <rutabaga/element.h>
 #include <rutabaga/window.h>
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, container_impl;
+static struct rtb_type_class container_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.container");
 
 /**
  * element implementation
@@ -42,8 +44,8 @@ attached(struct rtb_element *self,
 		struct rtb_element *parent, struct rtb_window *window)
 {
 	super.attached(self, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.container");
+	self->type = rtb_type_ref_class(window, self->type,
+			&container_type);
 }
 
 /**
@@ -63,7 +65,12 @@ rtb_container_new()
 		return NULL;
 	}
 
-	self->attached = attached;
+	if (!container_impl.draw) {
+		container_impl = super;
+		container_impl.attached = attached;
+	}
+
+	rtb_elem_set_impl(self, &container_impl);
 
 	return self;
 }
@@ -0,0 +1,169 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/render.h>
+#include <rutabaga/display-list.h>
+#include <rutabaga/stylequad-batch.h>
+
+#include "rtb_private/stdlib-allocator.h"
+
+#include "wwrl/vector.h"
+
+/**
+ * recording
+ */
+
+static void
+push_command(struct rtb_display_list *self,
+		const struct rtb_display_command *cmd)
+{
+	if (!self->commands.data)
+		VECTOR_INIT(&self->commands, &stdlib_allocator, 2);
+
+	VECTOR_PUSH_BACK(&self->commands, cmd);
+}
+
+void
+rtb_display_list_record_quad(struct rtb_display_list *self,
+		const struct rtb_stylequad_instance *instance,
+		const struct rtb_rect *bounds, rtb_stylequad_batch_kind_t kind,
+		GLuint texture, const struct rtb_size *texture_size)
+{
+	struct rtb_display_command cmd = {
+		.type     = RTB_DISPLAY_STYLEQUAD,
+		.kind     = kind,
+		.texture  = texture,
+		.bounds   = *bounds,
+		.instance = *instance
+	};
+
+	if (self->state != RTB_DISPLAY_LIST_RECORDING)
+		return;
+
+	if (texture_size)
+		cmd.texture_size = *texture_size;
+
+	push_command(self, &cmd);
+}
+
+void
+rtb_display_list_record_children(struct rtb_display_list *self)
+{
+	struct rtb_display_command cmd = {
+		.type = RTB_DISPLAY_CHILDREN
+	};
+
+	if (self->state != RTB_DISPLAY_LIST_RECORDING)
+		return;
+
+	push_command(self, &cmd);
+}
+
+void
+rtb_display_list_begin(struct rtb_display_list *self)
+{
+	if (self->commands.data)
+		VECTOR_CLEAR(&self->commands);
+
+	self->state = RTB_DISPLAY_LIST_RECORDING;
+}
+
+void
+rtb_display_list_end(struct rtb_display_list *self)
+{
+	if (self->state == RTB_DISPLAY_LIST_RECORDING)
+		self->state = RTB_DISPLAY_LIST_RECORDED;
+	else if (self->commands.data)
+		VECTOR_CLEAR(&self->commands);
+}
+
+/**
+ * replay
+ */
+
+void
+rtb_display_list_replay(struct rtb_display_list *self,
+		struct rtb_element *owner)
+{
+	struct rtb_render_context *ctx = rtb_render_get_context(owner);
+	const struct rtb_display_command *cmd;
+	size_t i;
+
+	for (i = 0; i < self->commands.size; i++) {
+		cmd = &self->commands.data[i];
+
+		switch (cmd->type) {
+		case RTB_DISPLAY_STYLEQUAD:
+			rtb_stylequad_batch_push(ctx->batch, ctx, &cmd->instance,
+					&cmd->bounds, cmd->kind,
+					cmd->texture, &cmd->texture_size);
+			break;
+
+		case RTB_DISPLAY_CHILDREN:
+			rtb_elem_draw_children(owner);
+			break;
+		}
+	}
+}
+
+/**
+ * invalidation
+ */
+
+void
+rtb_display_list_invalidate(struct rtb_display_list *self)
+{
+	self->state = RTB_DISPLAY_LIST_EMPTY;
+}
+
+void
+rtb_display_list_make_opaque(struct rtb_display_list *self)
+{
+	/* stays that way until it's invalidated, since it'd only end up
+	 * opaque again the next time around. */
+	self->state = RTB_DISPLAY_LIST_OPAQUE;
+}
+
+/**
+ * lifecycle
+ */
+
+void
+rtb_display_list_init(struct rtb_display_list *self)
+{
+	self->state = RTB_DISPLAY_LIST_EMPTY;
+	self->commands.data = NULL;
+	self->commands.size = 0;
+}
+
+void
+rtb_display_list_fini(struct rtb_display_list *self)
+{
+	if (self->commands.data)
+		VECTOR_FREE(&self->commands);
+}
@@ -43,12 +43,16 @@
 
 #include <rutabaga/event.h>
 #include <rutabaga/mouse.h>
+#include <rutabaga/platform.h>
 
 #include "rtb_private/stdlib-allocator.h"
 #include "rtb_private/layout-debug.h"
 
 #include "wwrl/vector.h"
 
+static struct rtb_type_class element_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.element");
+
 /**
  * state machine
  */
@@ -58,6 +62,8 @@
 static int
 change_state(struct rtb_element *self, rtb_elem_state_t state)
 {
+	rtb_restyle_flags_t scope;
+
 	if (self->state == RTB_STATE_UNATTACHED || state == RTB_STATE_UNATTACHED) {
 		self->state = state;
 		return 0;
@@ -66,8 +72,25 @@ change_state(struct rtb_element *self, rtb_elem_state_t state)
 	if (self->state == state)
 		return 0;
 
+	/* plenty of styles don't have separate properties for each state,
+	 * so there's nothing to restyle or redraw when moving between
+	 * states that compute to the same style. */
+	if (self->style && !rtb_style_states_differ(self->style,
+				self->state, state)) {
+		self->state = state;
+		return 0;
+	}
+
+	/* children only look at our style through the inherited
+	 * properties, so they're left alone unless one of those changed. */
+	if (!self->style || rtb_style_inherited_differ(self->window,
+				self->style, self->state, state))
+		scope = RTB_RESTYLE_TREE;
+	else
+		scope = RTB_RESTYLE_SELF;
+
 	self->state = state;
-	self->restyle(self);
+	rtb_elem_invalidate_style(self, scope);
 
 	return 0;
 }
@@ -183,10 +206,12 @@ reflow_rootward(struct rtb_element *self,
 		return 0;
 
 	TAILQ_FOREACH(iter, &self->children, child)
-		iter->reflow(iter, self, RTB_DIRECTION_LEAFWARD);
+		RTB_IMPL(iter)->reflow(iter, self, RTB_DIRECTION_LEAFWARD);
+
+	rtb_elem_cull_children(self);
 
 	if (self->parent)
-		self->parent->reflow(self->parent, self, direction);
+		RTB_IMPL(self->parent)->reflow(self->parent, self, direction);
 
 	rtb_elem_mark_dirty(self);
 	return 1;
@@ -201,16 +226,24 @@ reflow_leafward(struct rtb_element *self,
 	self->layout_cb(self);
 
 	TAILQ_FOREACH(iter, &self->children, child)
-		iter->reflow(iter, self, direction);
+		RTB_IMPL(iter)->reflow(iter, self, direction);
+
+	rtb_elem_cull_children(self);
 }
 
 static int
 reflow(struct rtb_element *self,
 		struct rtb_element *instigator, rtb_ev_direction_t direction)
 {
+	struct rtb_profiler *profiler;
+	int ret = 1;
+
 	if (!self->window->finished_initialising)
 		return 0;
 
+	profiler = &self->window->local_storage.profiler;
+	rtb_profiler_begin(profiler, RTB_PROFILE_REFLOW);
+
 	rtb_rect_update_points_from_size(&self->rect);
 
 	self->inner_rect.x  = self->x  + self->outer_pad.x;
@@ -220,11 +253,17 @@ reflow(struct rtb_element *self,
 	rtb_rect_update_size_from_points(&self->inner_rect);
 
 	rtb_stylequad_update_geometry(&self->stylequad, &self->rect);
+	rtb_display_list_invalidate(&self->display_list);
+
+	/* a parent reflowing us culls all of its children once we're done.
+	 * anyone else moving us could have uncovered or covered up one of
+	 * our siblings, so they all need another look. */
+	if (self->parent && instigator != self->parent)
+		rtb_elem_cull_children(self->parent);
 
 	switch (direction) {
 	case RTB_DIRECTION_ROOTWARD:
-		if (!reflow_rootward(self, instigator, RTB_DIRECTION_ROOTWARD))
-			return 0;
+		ret = reflow_rootward(self, instigator, RTB_DIRECTION_ROOTWARD);
 		break;
 
 	case RTB_DIRECTION_LEAFWARD:
@@ -232,7 +271,106 @@ reflow(struct rtb_element *self,
 		break;
 	}
 
-	return 1;
+	rtb_profiler_end(profiler, RTB_PROFILE_REFLOW);
+	return ret;
+}
+
+/**
+ * culling
+ */
+
+/* covering a sibling needs a full-rect containment test against every
+ * opaque element drawn on top of it, so only the topmost few are kept
+ * around. */
+#define MAX_OCCLUDERS 16
+
+static rtb_visibility_t
+viewport_visibility(struct rtb_element *self)
+{
+	const struct rtb_rect *viewport;
+
+	/* an element with no area of its own can still have children
+	 * hanging off of it, so leave it be. */
+	if (!self->surface || rtb_rect_is_empty(&self->rect))
+		return RTB_UNOBSCURED;
+
+	viewport = &RTB_ELEMENT(self->surface)->rect;
+
+	if (!rtb_rect_intersects(&self->rect, viewport))
+		return RTB_FULLY_OBSCURED;
+	else if (!rtb_rect_contains(viewport, &self->rect))
+		return RTB_PARTIALLY_OBSCURED;
+
+	return RTB_UNOBSCURED;
+}
+
+static int
+is_occluder(struct rtb_element *self)
+{
+	const struct rtb_rgb_color *bg = self->stylequad.properties.bg_color;
+
+	/* XXX: assumes that anything with an opaque background-color
+	 *      fills its whole rect with it. */
+	return bg && bg->a >= 1.f
+		&& self->visibility != RTB_FULLY_OBSCURED
+		&& !rtb_rect_is_empty(&self->rect);
+}
+
+void
+rtb_elem_cull_children(struct rtb_element *self)
+{
+	struct rtb_element *occluders[MAX_OCCLUDERS], *iter;
+	rtb_visibility_t was;
+	int i, noccluders = 0;
+
+	if (self->child_index)
+		rtb_child_index_invalidate(self->child_index);
+
+	if (!self->window || !self->window->finished_initialising)
+		return;
+
+	/* later children draw on top of earlier ones, so walk back to
+	 * front and test each against what we've seen so far. */
+	TAILQ_FOREACH_REVERSE(iter, &self->children, children, child) {
+		was = iter->visibility;
+		iter->visibility = viewport_visibility(iter);
+
+		for (i = 0; i < noccluders
+				&& iter->visibility != RTB_FULLY_OBSCURED; i++)
+			if (rtb_rect_contains(&occluders[i]->rect, &iter->rect))
+				iter->visibility = RTB_FULLY_OBSCURED;
+
+		if (noccluders < MAX_OCCLUDERS && is_occluder(iter))
+			occluders[noccluders++] = iter;
+
+		/* nothing was drawn for it while it was culled. */
+		if (was == RTB_FULLY_OBSCURED
+				&& iter->visibility != RTB_FULLY_OBSCURED)
+			rtb_elem_mark_dirty(iter);
+	}
+}
+
+/**
+ * hit-testing
+ */
+
+struct rtb_element *
+rtb_elem_child_at(struct rtb_element *self, const struct rtb_point *pt)
+{
+	struct rtb_element *iter;
+
+	if ((self->flags & RTB_ELEM_INDEX_CHILDREN) && !self->child_index)
+		self->child_index = rtb_child_index_new();
+
+	if (self->child_index)
+		return rtb_child_index_find(self->child_index, self, pt);
+
+	TAILQ_FOREACH_REVERSE(iter, &self->children, children, child)
+		if (RTB_POINT_IN_RECT(*pt, *iter)
+				&& iter->visibility != RTB_FULLY_OBSCURED)
+			return iter;
+
+	return NULL;
 }
 
 /**
@@ -245,12 +383,14 @@ reload_style(struct rtb_element *self)
 	const struct rtb_style_property_definition *prop;
 	int need_reflow = 0;
 
+	rtb_display_list_invalidate(&self->display_list);
+
 	/* layout-related properties trigger a reflow if they change, so
 	 * we'll handle them first. */
 
-#define ASSIGN_LAYOUT_FLOAT(pname, dest) do {                         \
-	prop = rtb_style_query_prop(self,                                 \
-			pname, RTB_STYLE_PROP_FLOAT, 0);                          \
+#define ASSIGN_LAYOUT_FLOAT(id, dest) do {                            \
+	prop = rtb_style_query_prop_id(self,                              \
+			id, RTB_STYLE_PROP_FLOAT, 0);                             \
 	if (!prop)                                                        \
 		break;                                                        \
 	if (self->dest != prop->flt                                       \
@@ -261,30 +401,38 @@ reload_style(struct rtb_element *self)
 		self->dest = prop->flt;                                       \
 } while (0)
 
-	ASSIGN_LAYOUT_FLOAT("min-width", min_size.w);
-	ASSIGN_LAYOUT_FLOAT("min-height", min_size.h);
+	ASSIGN_LAYOUT_FLOAT(RTB_STYLE_PROP_ID_MIN_WIDTH, min_size.w);
+	ASSIGN_LAYOUT_FLOAT(RTB_STYLE_PROP_ID_MIN_HEIGHT, min_size.h);
 
 #undef ASSIGN_LAYOUT_FLOAT
 
-#define LOAD_PROP(name, type, member, load_func)                      \
-	if ((prop = rtb_style_query_prop(self, name, type, 0))            \
+#define LOAD_PROP(id, type, member, load_func)                        \
+	if ((prop = rtb_style_query_prop_id(self, id, type, 0))           \
 			&& !load_func(&self->stylequad, &prop->member))           \
 
-#define LOAD_COLOR(name, load_func)                                   \
-		LOAD_PROP(name, RTB_STYLE_PROP_COLOR, color, load_func) {     \
+#define LOAD_COLOR(id, load_func)                                     \
+		LOAD_PROP(id, RTB_STYLE_PROP_COLOR, color, load_func) {       \
 			rtb_elem_mark_dirty(self);                                \
 		}
 
-#define LOAD_TEXTURE(name, load_func)                                 \
-		LOAD_PROP(name, RTB_STYLE_PROP_TEXTURE, texture, load_func) { \
-			rtb_elem_mark_dirty(self);                                \
-		}
+#define LOAD_TEXTURE(id, load_func)                                   \
+	if ((prop = rtb_style_query_prop_id(self,                         \
+					id, RTB_STYLE_PROP_TEXTURE, 0))                   \
+			&& !load_func(&self->stylequad,                           \
+				&self->window->local_storage.textures,                \
+				&prop->texture)) {                                    \
+		rtb_elem_mark_dirty(self);                                    \
+	}
 
-	LOAD_COLOR("background-color", rtb_stylequad_set_background_color);
-	LOAD_COLOR("border-color", rtb_stylequad_set_border_color);
+	LOAD_COLOR(RTB_STYLE_PROP_ID_BACKGROUND_COLOR,
+			rtb_stylequad_set_background_color);
+	LOAD_COLOR(RTB_STYLE_PROP_ID_BORDER_COLOR,
+			rtb_stylequad_set_border_color);
 
-	LOAD_TEXTURE("border-image", rtb_stylequad_set_border_image);
-	LOAD_TEXTURE("background-image", rtb_stylequad_set_background_image);
+	LOAD_TEXTURE(RTB_STYLE_PROP_ID_BORDER_IMAGE,
+			rtb_stylequad_set_border_image);
+	LOAD_TEXTURE(RTB_STYLE_PROP_ID_BACKGROUND_IMAGE,
+			rtb_stylequad_set_background_image);
 
 #undef LOAD_TEXTURE
 #undef LOAD_COLOR
@@ -297,17 +445,38 @@ reload_style(struct rtb_element *self)
 static void
 restyle(struct rtb_element *self)
 {
-	struct rtb_element *iter;
+	struct rtb_profiler *profiler;
+	int was_occluder;
 
 	assert(self->window->state != RTB_STATE_UNATTACHED);
 
+	profiler = &self->window->local_storage.profiler;
+	rtb_profiler_begin(profiler, RTB_PROFILE_RESTYLE);
+
 	if (!self->style)
 		self->style = rtb_style_for_element(self, self->window->style_list);
 
+	was_occluder = is_occluder(self);
 	reload_style(self);
 
+	/* our siblings' culling depends on whether our background is
+	 * opaque, which the new style might have changed. */
+	if (was_occluder != is_occluder(self) && self->parent)
+		rtb_elem_cull_children(self->parent);
+
+	rtb_profiler_end(profiler, RTB_PROFILE_RESTYLE);
+}
+
+static void
+restyle_tree(struct rtb_element *self)
+{
+	struct rtb_element *iter;
+
+	self->restyle_pending = 0;
+	RTB_IMPL(self)->restyle(self);
+
 	TAILQ_FOREACH(iter, &self->children, child)
-		iter->restyle(iter);
+		restyle_tree(iter);
 }
 
 /**
@@ -347,12 +516,12 @@ attached(struct rtb_element *self,
 	self->parent = parent;
 	self->window = window;
 
-	self->type = rtb_type_ref(window, NULL, "net.illest.rutabaga.element");
+	self->type = rtb_type_ref_class(window, NULL, &element_type);
 
 	self->layout_cb(self);
 
 	TAILQ_FOREACH(iter, &self->children, child)
-		self->child_attached(self, iter);
+		RTB_IMPL(self)->child_attached(self, iter);
 
 	change_state(self, RTB_STATE_NORMAL);
 }
@@ -370,7 +539,7 @@ detached(struct rtb_element *self,
 	self->type = NULL;
 
 	TAILQ_FOREACH(iter, &self->children, child)
-		self->child_detached(self, iter);
+		RTB_IMPL(self)->child_detached(self, iter);
 
 	change_state(self, RTB_STATE_UNATTACHED);
 }
@@ -379,13 +548,13 @@ static void
 child_attached(struct rtb_element *self, struct rtb_element *child)
 {
 	child->surface = self->surface;
-	child->attached(child, self, self->window);
+	RTB_IMPL(child)->attached(child, self, self->window);
 }
 
 static void
 child_detached(struct rtb_element *self, struct rtb_element *child)
 {
-	child->detached(child, self, self->window);
+	RTB_IMPL(child)->detached(child, self, self->window);
 }
 
 static void
@@ -393,12 +562,19 @@ mark_dirty(struct rtb_element *self)
 {
 	struct rtb_surface *surface = self->surface;
 
-	for (; self != RTB_ELEMENT(surface); self = self->parent) {
-		if (self->visibility == RTB_FULLY_OBSCURED)
-			return;
+	rtb_display_list_invalidate(&self->display_list);
 
-		if (rtb_elem_is_clearable(self))
-			break;
+	/* a surface repainting by damage only needs to know what changed.
+	 * otherwise we redraw from the nearest ancestor that can be cleared
+	 * without wiping out a background behind it. */
+	if (!surface || surface->repaint_mode == RTB_SURFACE_REPAINT_SUBTREE) {
+		for (; self != RTB_ELEMENT(surface); self = self->parent) {
+			if (self->visibility == RTB_FULLY_OBSCURED)
+				return;
+
+			if (rtb_elem_is_clearable(self))
+				break;
+		}
 	}
 
 	if (!surface || surface->surface_state == RTB_SURFACE_INVALID
@@ -424,7 +600,7 @@ rtb_elem_deliver_event(struct rtb_element *self, const struct rtb_event *e)
 	if (self->state == RTB_STATE_UNATTACHED)
 		return 0;
 
-	ret = self->on_event(self, e);
+	ret = RTB_IMPL(self)->on_event(self, e);
 	ret = rtb_handle(self, e) || ret;
 
 	switch (e->type) {
@@ -460,26 +636,81 @@ rtb_elem_deliver_event(struct rtb_element *self, const struct rtb_event *e)
 void
 rtb_elem_draw_children(struct rtb_element *self)
 {
+	struct rtb_render_context *ctx = rtb_render_get_context(self);
+	struct rtb_display_list *recording = ctx->recording;
 	struct rtb_element *iter;
 
+	/* children keep display lists of their own, so all we note down is
+	 * where they go. */
+	if (recording) {
+		if (recording == &self->display_list)
+			rtb_display_list_record_children(recording);
+		else
+			rtb_display_list_make_opaque(recording);
+	}
+
+	ctx->recording = NULL;
+
 	TAILQ_FOREACH(iter, &self->children, child)
 		rtb_elem_draw(iter, 0);
+
+	ctx->recording = recording;
 }
 
 void
 rtb_elem_draw(struct rtb_element *self, int clear_first)
 {
+	struct rtb_display_list *list = &self->display_list;
+	struct rtb_render_context *ctx;
+	struct rtb_display_list *recording;
+
 	if (self->visibility == RTB_FULLY_OBSCURED)
 		return;
 
+	/* not in the region being repainted, so neither are our children. */
+	ctx = rtb_render_get_context(self);
+	if (ctx->clip && !rtb_rect_intersects(&self->rect, ctx->clip))
+		return;
+
+	self->window->local_storage.state.stats.repainted_elements++;
+	rtb_profiler_begin(&self->window->local_storage.profiler,
+			RTB_PROFILE_ELEMENT);
+
 	rtb_render_push(self);
 	if (clear_first)
 		rtb_render_clear(self);
 
-	self->draw(self);
-	LAYOUT_DEBUG_DRAW_BOX(self);
+	/* whoever's drawing us is doing it without going through
+	 * rtb_elem_draw_children(), so they can't be replayed. that holds
+	 * even if we replay, since our quads go straight to the batch and
+	 * never land in their list. */
+	recording = ctx->recording;
+	if (recording)
+		rtb_display_list_make_opaque(recording);
+
+	if (ctx->batch && rtb_display_list_is_replayable(list)) {
+		rtb_display_list_replay(list, self);
+		goto out;
+	}
+
+	if (ctx->batch && list->state != RTB_DISPLAY_LIST_OPAQUE) {
+		rtb_display_list_begin(list);
+		ctx->recording = list;
+	} else
+		ctx->recording = NULL;
 
+	RTB_IMPL(self)->draw(self);
+
+	if (ctx->recording)
+		rtb_display_list_end(list);
+	ctx->recording = recording;
+
+out:
+	LAYOUT_DEBUG_DRAW_BOX(self);
 	rtb_render_pop(self);
+
+	rtb_profiler_end(&self->window->local_storage.profiler,
+			RTB_PROFILE_ELEMENT);
 }
 
 int
@@ -525,7 +756,7 @@ void
 rtb_elem_trigger_reflow(struct rtb_element *self, struct rtb_element *instigator,
 		rtb_ev_direction_t direction)
 {
-	self->reflow(self, instigator, direction);
+	RTB_IMPL(self)->reflow(self, instigator, direction);
 }
 
 void
@@ -543,7 +774,24 @@ rtb_elem_reflow_rootward(struct rtb_element *self)
 void
 rtb_elem_mark_dirty(struct rtb_element *self)
 {
-	self->mark_dirty(self);
+	RTB_IMPL(self)->mark_dirty(self);
+}
+
+void
+rtb_elem_set_impl(struct rtb_element *self,
+		const struct rtb_element_implementation *impl)
+{
+#ifdef RTB_SHARED_IMPL
+	self->impl = impl;
+#else
+	rtb_elem_cb_size_t size_cb = self->size_cb;
+	rtb_elem_cb_t layout_cb = self->layout_cb;
+
+	/* layout and sizing belong to the instance, not the class */
+	self->impl = *impl;
+	self->size_cb = size_cb;
+	self->layout_cb = layout_cb;
+#endif
 }
 
 void
@@ -597,34 +845,87 @@ rtb_elem_is_in_tree(struct rtb_element *root, struct rtb_element *leaf)
 	return 0;
 }
 
+void
+rtb_elem_invalidate_style(struct rtb_element *self, rtb_restyle_flags_t scope)
+{
+	struct rtb_window *win = self->window;
+
+	if (!win || win->state == RTB_STATE_UNATTACHED)
+		return;
+
+	self->restyle_pending |= scope;
+
+	/* mark the path up to the window so the pass can find us without
+	 * walking the whole tree. stops at the first ancestor that's
+	 * already marked, since everything above it is too. */
+	for (; self->parent; self = self->parent) {
+		if (self->parent->restyle_pending & RTB_RESTYLE_BELOW)
+			return;
+
+		self->parent->restyle_pending |= RTB_RESTYLE_BELOW;
+	}
+
+	if (!win->dirty)
+		rtb__platform_request_frame(win);
+}
+
+void
+rtb_elem_restyle_pending(struct rtb_element *self)
+{
+	rtb_restyle_flags_t pending = self->restyle_pending;
+	struct rtb_element *iter;
+
+	if (!pending)
+		return;
+
+	if (pending & RTB_RESTYLE_TREE) {
+		restyle_tree(self);
+		return;
+	}
+
+	self->restyle_pending = 0;
+
+	if (pending & RTB_RESTYLE_SELF)
+		RTB_IMPL(self)->restyle(self);
+
+	if (pending & RTB_RESTYLE_BELOW)
+		TAILQ_FOREACH(iter, &self->children, child)
+			rtb_elem_restyle_pending(iter);
+}
+
 void
 rtb_elem_add_child(struct rtb_element *self, struct rtb_element *child,
 		rtb_child_add_loc_t where)
 {
-	assert(child->draw);
-	assert(child->on_event);
+	assert(RTB_IMPL(child)->draw);
+	assert(RTB_IMPL(child)->on_event);
 	assert(child->layout_cb);
 	assert(child->size_cb);
-	assert(child->attached);
-	assert(child->detached);
-	assert(child->child_attached);
-	assert(child->child_detached);
-	assert(child->reflow);
-	assert(child->restyle);
-	assert(child->mark_dirty);
+	assert(RTB_IMPL(child)->attached);
+	assert(RTB_IMPL(child)->detached);
+	assert(RTB_IMPL(child)->child_attached);
+	assert(RTB_IMPL(child)->child_detached);
+	assert(RTB_IMPL(child)->reflow);
+	assert(RTB_IMPL(child)->restyle);
+	assert(RTB_IMPL(child)->mark_dirty);
 
 	if (where == RTB_ADD_HEAD)
 		TAILQ_INSERT_HEAD(&self->children, child, child);
 	else
 		TAILQ_INSERT_TAIL(&self->children, child, child);
 
+	if (self->child_index)
+		rtb_child_index_invalidate(self->child_index);
+
 	if (self->state != RTB_STATE_UNATTACHED) {
-		self->child_attached(self, child);
+		RTB_IMPL(self)->child_attached(self, child);
 
+		/* right away rather than in the restyle pass, since the
+		 * reflow below wants the child's minimum size. */
 		if (self->window->state != RTB_STATE_UNATTACHED)
-			self->restyle(self);
+			restyle_tree(child);
 
-		self->reflow(self, child, RTB_DIRECTION_ROOTWARD);
+		RTB_IMPL(self)->reflow(self, child, RTB_DIRECTION_ROOTWARD);
 	}
 }
 
@@ -633,6 +934,9 @@ rtb_elem_remove_child(struct rtb_element *self, struct rtb_element *child)
 {
 	TAILQ_REMOVE(&self->children, child, child);
 
+	if (self->child_index)
+		rtb_child_index_invalidate(self->child_index);
+
 	if (self->state == RTB_STATE_UNATTACHED)
 		return;
 
@@ -654,13 +958,13 @@ rtb_elem_remove_child(struct rtb_element *self, struct rtb_element *child)
 		self->window->mouse.element_underneath = self;
 	}
 
-	self->child_detached(self, child);
+	RTB_IMPL(self)->child_detached(self, child);
 
 	child->parent = NULL;
 	child->style  = NULL;
 	child->state  = RTB_STATE_UNATTACHED;
 
-	self->reflow(self, NULL, RTB_DIRECTION_LEAFWARD);
+	RTB_IMPL(self)->reflow(self, NULL, RTB_DIRECTION_LEAFWARD);
 }
 
 static struct rtb_element_implementation base_impl = {
@@ -688,7 +992,9 @@ rtb_elem_init(struct rtb_element *self)
 	memset(self, 0, sizeof(*self));
 	TAILQ_INIT(&self->children);
 
-	self->impl = base_impl;
+	rtb_elem_set_impl(self, &base_impl);
+	self->layout_cb = base_impl.layout_cb;
+	self->size_cb   = base_impl.size_cb;
 
 	self->metatype    = RTB_TYPE_ATOM;
 	self->style       = NULL;
@@ -709,6 +1015,7 @@ rtb_elem_init(struct rtb_element *self)
 	VECTOR_INIT(&self->handlers, &stdlib_allocator, 1);
 
 	rtb_stylequad_init(&self->stylequad);
+	rtb_display_list_init(&self->display_list);
 
 	LAYOUT_DEBUG_INIT();
 
@@ -718,7 +1025,11 @@ rtb_elem_init(struct rtb_element *self)
 void
 rtb_elem_fini(struct rtb_element *self)
 {
+	rtb_display_list_fini(&self->display_list);
 	rtb_stylequad_fini(&self->stylequad);
 	VECTOR_FREE(&self->handlers);
+
+	if (self->child_index)
+		rtb_child_index_free(self->child_index);
 	rtb_type_unref(self->type);
 }
@@ -0,0 +1,238 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/platform.h>
+#include <rutabaga/mutation-queue.h>
+
+#include <rutabaga/widgets/label.h>
+#include <rutabaga/widgets/value.h>
+
+/**
+ * the queue itself
+ */
+
+static void
+push(struct rtb_mutation_queue *self, struct rtb_mutation *mut)
+{
+	struct rtb_mutation *prev;
+
+	__atomic_store_n(&mut->next, NULL, __ATOMIC_RELAXED);
+	prev = __atomic_exchange_n(&self->head, mut, __ATOMIC_ACQ_REL);
+
+	/* between the exchange and this store, the consumer can see the
+	 * queue as empty past `prev`. it just picks `mut` up next time. */
+	__atomic_store_n(&prev->next, mut, __ATOMIC_RELEASE);
+}
+
+static struct rtb_mutation *
+pop(struct rtb_mutation_queue *self)
+{
+	struct rtb_mutation *tail, *next, *head;
+
+	tail = self->tail;
+	next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+	if (tail == &self->stub) {
+		if (!next)
+			return NULL;
+
+		self->tail = tail = next;
+		next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	}
+
+	if (next) {
+		self->tail = next;
+		return tail;
+	}
+
+	/* `tail` is the last one in, unless a producer is halfway through
+	 * adding another after it. either way, it can't come out until
+	 * something's behind it, so we put the stub back in. */
+	head = __atomic_load_n(&self->head, __ATOMIC_ACQUIRE);
+	if (tail != head)
+		return NULL;
+
+	push(self, &self->stub);
+
+	next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	if (next) {
+		self->tail = next;
+		return tail;
+	}
+
+	return NULL;
+}
+
+static void
+release(struct rtb_mutation *mut)
+{
+	if (!mut->owned)
+		return;
+
+	if (mut->type == RTB_MUTATION_SET_TEXT)
+		free(mut->set_text.text);
+
+	free(mut);
+}
+
+static void
+apply(struct rtb_window *win, struct rtb_mutation *mut)
+{
+	switch (mut->type) {
+	case RTB_MUTATION_CALL:
+		mut->call.cb(win, mut, mut->call.ctx);
+		break;
+
+	case RTB_MUTATION_SET_VALUE:
+		rtb_value_element_set_value(mut->set_value.elem,
+				mut->set_value.value, RTB_EVENT_SYNTHETIC);
+		break;
+
+	case RTB_MUTATION_SET_TEXT:
+		rtb_label_set_text(mut->set_text.label, mut->set_text.text);
+		break;
+	}
+
+	release(mut);
+}
+
+int
+rtb_mutation_queue_is_empty(struct rtb_mutation_queue *self)
+{
+	return self->tail == &self->stub
+		&& !__atomic_load_n(&self->stub.next, __ATOMIC_ACQUIRE);
+}
+
+void
+rtb_mutation_queue_drain(struct rtb_mutation_queue *self,
+		struct rtb_window *win)
+{
+	struct rtb_mutation *mut;
+
+	while ((mut = pop(self)))
+		apply(win, mut);
+}
+
+void
+rtb_mutation_queue_init(struct rtb_mutation_queue *self)
+{
+	self->stub.next = NULL;
+	self->head = self->tail = &self->stub;
+}
+
+void
+rtb_mutation_queue_fini(struct rtb_mutation_queue *self)
+{
+	struct rtb_mutation *mut;
+
+	/* whatever the elements were, they're gone by now. */
+	while ((mut = pop(self)))
+		release(mut);
+}
+
+/**
+ * public API
+ */
+
+void
+rtb_window_post(struct rtb_window *win, struct rtb_mutation *mut)
+{
+	push(&win->mutations, mut);
+	rtb__platform_request_frame(win);
+}
+
+static struct rtb_mutation *
+new_mutation(rtb_mutation_type_t type)
+{
+	struct rtb_mutation *mut = calloc(1, sizeof(*mut));
+
+	if (!mut)
+		return NULL;
+
+	mut->type = type;
+	mut->owned = 1;
+	return mut;
+}
+
+int
+rtb_window_post_call(struct rtb_window *win,
+		rtb_mutation_cb_t cb, void *ctx)
+{
+	struct rtb_mutation *mut = new_mutation(RTB_MUTATION_CALL);
+
+	if (!mut)
+		return -1;
+
+	mut->call.cb  = cb;
+	mut->call.ctx = ctx;
+
+	rtb_window_post(win, mut);
+	return 0;
+}
+
+int
+rtb_window_post_value(struct rtb_window *win,
+		struct rtb_value_element *elem, float value)
+{
+	struct rtb_mutation *mut = new_mutation(RTB_MUTATION_SET_VALUE);
+
+	if (!mut)
+		return -1;
+
+	mut->set_value.elem  = elem;
+	mut->set_value.value = value;
+
+	rtb_window_post(win, mut);
+	return 0;
+}
+
+int
+rtb_window_post_text(struct rtb_window *win,
+		struct rtb_label *label, const rtb_utf8_t *text)
+{
+	struct rtb_mutation *mut = new_mutation(RTB_MUTATION_SET_TEXT);
+
+	if (!mut)
+		goto err_mut;
+
+	if (!(mut->set_text.text = strdup(text)))
+		goto err_text;
+
+	mut->set_text.label = label;
+
+	rtb_window_post(win, mut);
+	return 0;
+
+err_text:
+	free(mut);
+err_mut:
+	return -1;
+}
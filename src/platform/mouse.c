@@ -309,20 +309,14 @@ retarget(struct rtb_window *win, int x, int y)
 		ret = ret->parent;
 	}
 
-descend:
-	TAILQ_FOREACH_REVERSE(iter, &ret->children, children, child) {
-		if (RTB_POINT_IN_RECT(cursor, *iter)
-				&& iter->visibility != RTB_FULLY_OBSCURED) {
-			ret = iter;
-			ret->mouse_in = 1;
+	while ((iter = rtb_elem_child_at(ret, &cursor))) {
+		ret = iter;
+		ret->mouse_in = 1;
 
-			dispatch_simple_mouse_event(win, ret, RTB_MOUSE_ENTER, -1, x, y);
+		dispatch_simple_mouse_event(win, ret, RTB_MOUSE_ENTER, -1, x, y);
 
-			if (win->mouse.buttons_down)
-				dispatch_drag_enter(win, ret, x, y);
-
-			goto descend;
-		}
+		if (win->mouse.buttons_down)
+			dispatch_drag_enter(win, ret, x, y);
 	}
 
 	win->mouse.element_underneath = ret;
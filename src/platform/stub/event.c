@@ -24,32 +24,187 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdio.h>
+
+#include <uv.h>
+
 #include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
 #include <rutabaga/event.h>
-#include "rtb_private/window_impl.h"
+#include <rutabaga/keyboard.h>
+#include <rutabaga/headless.h>
+
+#include "rtb_private/util.h"
+
+#include "headless.h"
+
+/**
+ * keyboard
+ */
+
+rtb_modkey_t
+rtb_get_modkeys(struct rtb_window *rwin)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+	return self->modkeys;
+}
+
+void
+rtb_headless_set_modkeys(struct rtb_window *rwin, rtb_modkey_t modkeys)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+	self->modkeys = modkeys;
+}
+
+void
+rtb_headless_key(struct rtb_window *win, rtb_ev_type_t type,
+		rtb_keysym_t keysym, rtb_utf32_t character)
+{
+	struct rtb_key_event rtb_ev = {
+		.type      = type,
+		.keysym    = keysym,
+		.character = character,
+		.mod_keys  = rtb_get_modkeys(win)
+	};
+
+	rtb_dispatch_raw(RTB_ELEMENT(win), RTB_EVENT(&rtb_ev));
+}
+
+/**
+ * frames
+ */
+
+static int
+run_frame(struct rtb_window *win)
+{
+	int drawn;
+
+	if (win->need_reconfigure) {
+		rtb_window_reinit(win);
+		win->need_reconfigure = 0;
+	}
+
+	win->present.frame_time = ((struct headless_rutabaga *) win->rtb)->now;
+	drawn = rtb_window_draw(win, 0);
+
+	/* there's nothing to swap, but whoever reads the pixels back or
+	 * times us wants the frame to have been submitted. */
+	if (drawn)
+		glFlush();
+
+	return drawn;
+}
+
+static void
+clock_cb(uv_idle_t *_handle)
+{
+	struct headless_frame_clock *clock;
+
+	clock = RTB_DOWNCAST(_handle, headless_frame_clock, uv_idle_s);
+	rtb_headless_step((struct rutabaga *) clock->hrtb,
+			RTB_HEADLESS_FRAME_NSEC);
+}
+
+static void
+wake_cb(uv_async_t *handle)
+{
+	struct headless_frame_clock *clock =
+		RTB_CONTAINER_OF(handle, struct headless_frame_clock, wake);
+
+	uv_idle_start(RTB_UPCAST(clock, uv_idle_s), clock_cb);
+}
+
+void
+rtb__platform_request_frame(struct rtb_window *win)
+{
+	struct headless_rutabaga *hrtb = (void *) win->rtb;
+
+	/* rtb_window_open() hasn't set win->rtb yet while it's still
+	 * building the window. the loop starts out running regardless. */
+	if (hrtb && hrtb->clock.running)
+		uv_async_send(&hrtb->clock.wake);
+}
+
+uint64_t
+rtb_headless_time(struct rutabaga *r)
+{
+	struct headless_rutabaga *hrtb = (void *) r;
+	return hrtb->now;
+}
+
+int
+rtb_headless_step(struct rutabaga *r, uint64_t nsec)
+{
+	struct headless_rutabaga *hrtb = (void *) r;
+	struct rtb_window *win = r->win;
+	int drawn;
+
+	hrtb->now += nsec;
+
+	if (!win)
+		return 0;
+
+	rtb_window_lock(win);
+	drawn = run_frame(win);
+
+	/* with nothing left to draw, the loop gets to block until something
+	 * asks for a frame again. */
+	if (hrtb->clock.running && !rtb_window_wants_frame(win))
+		uv_idle_stop(RTB_UPCAST(&hrtb->clock, uv_idle_s));
+
+	rtb_window_unlock(win);
+
+	return drawn;
+}
+
+/**
+ * event loop
+ */
 
 void
 rtb_event_loop_init(struct rutabaga *r)
 {
-	r->event_loop = uv_loop_new();
+	struct headless_rutabaga *hrtb = (void *) r;
+
+	/* while the window wants frames, an idle handle keeps the loop from
+	 * blocking, so they come as fast as we can draw them and the clock
+	 * does the pacing. */
+	hrtb->clock.hrtb = hrtb;
+	uv_idle_init(&r->event_loop, RTB_UPCAST(&hrtb->clock, uv_idle_s));
+	uv_async_init(&r->event_loop, &hrtb->clock.wake, wake_cb);
+
+	if (r->win)
+		headless_window_own_context(
+				RTB_WINDOW_AS(r->win, headless_window), &r->event_loop);
+
+	hrtb->clock.running = 1;
+	uv_idle_start(RTB_UPCAST(&hrtb->clock, uv_idle_s), clock_cb);
 }
 
 void
 rtb_event_loop_run(struct rutabaga *r)
 {
+	uv_run(&r->event_loop, UV_RUN_DEFAULT);
 }
 
 void
 rtb_event_loop_stop(struct rutabaga *r)
 {
+	uv_stop(&r->event_loop);
 }
 
 void
 rtb_event_loop_fini(struct rutabaga *r)
 {
-	uv_loop_t *rtb_loop;
+	struct headless_rutabaga *hrtb = (void *) r;
+
+	hrtb->clock.running = 0;
+
+	if (r->win)
+		headless_window_disown_context(
+				RTB_WINDOW_AS(r->win, headless_window));
 
-	rtb_loop = r->event_loop;
-	r->event_loop = NULL;
-	uv_loop_delete(rtb_loop);
+	uv_close((void *) &hrtb->clock.wake, NULL);
+	uv_close((void *) RTB_UPCAST(&hrtb->clock, uv_idle_s), NULL);
+	uv_run(&r->event_loop, UV_RUN_NOWAIT);
 }
@@ -0,0 +1,94 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/keyboard.h>
+
+#include <uv.h>
+
+#include <EGL/egl.h>
+
+#define ERR(...) fprintf(stderr, "rutabaga headless: " __VA_ARGS__)
+
+#define HEADLESS_DPI 96
+
+struct headless_frame_clock {
+	RTB_INHERIT(uv_idle_s);
+	uv_async_t wake;
+
+	struct headless_rutabaga *hrtb;
+	int running;
+};
+
+struct headless_rutabaga {
+	struct rutabaga rtb;
+
+	EGLDisplay dpy;
+	EGLConfig config;
+
+	/* if the display can't make a context current without a surface,
+	 * each window gets a tiny pbuffer to hang its context off of. */
+	int surfaceless;
+
+	uint64_t now;
+	struct headless_frame_clock clock;
+
+	struct {
+		rtb_utf8_t *buffer;
+		size_t nbytes;
+	} clipboard;
+};
+
+struct headless_window {
+	RTB_INHERIT(rtb_window);
+
+	struct headless_rutabaga *hrtb;
+
+	EGLContext gl_ctx;
+	EGLSurface gl_surface;
+
+	GLuint fbo;
+	GLuint color;
+
+	rtb_modkey_t modkeys;
+
+	/* same arrangement as the x11 backend: the event loop's thread keeps
+	 * the context, and other threads borrow it through `handoff`. */
+	struct {
+		uv_thread_t owner;
+		int owned;
+		int current;
+
+		uv_async_t handoff;
+		uv_cond_t released;
+	} context;
+};
+
+int headless_window_make_current(struct headless_window *);
+
+void headless_window_own_context(struct headless_window *, uv_loop_t *);
+void headless_window_disown_context(struct headless_window *);
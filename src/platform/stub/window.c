@@ -24,29 +24,472 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <uv.h>
+
+#include <rutabaga/opengl.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/headless.h>
+
 #include "rtb_private/window_impl.h"
+#include "rtb_private/util.h"
+
+#include "headless.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+/**
+ * display
+ */
+
+static int
+has_egl_extension(EGLDisplay dpy, const char *name)
+{
+	const char *exts = eglQueryString(dpy, EGL_EXTENSIONS);
+	size_t len = strlen(name);
+
+	for (; exts && (exts = strstr(exts, name)); exts += len)
+		if (exts[len] == ' ' || exts[len] == '\0')
+			return 1;
+
+	return 0;
+}
+
+static EGLDisplay
+open_display(void)
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+
+	/* mesa can give us a display that doesn't need a window system at
+	 * all. anywhere else, the default display will have to do. */
+	if (has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+		get_platform_display = (void *)
+			eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		if (get_platform_display)
+			return get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+					EGL_DEFAULT_DISPLAY, NULL);
+	}
+
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+static int
+find_config(EGLDisplay dpy, EGLConfig *config)
+{
+	EGLint nconfigs;
+	EGLint attribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+
+	if (!eglChooseConfig(dpy, attribs, config, 1, &nconfigs) || !nconfigs)
+		return -1;
+
+	return 0;
+}
 
 struct rutabaga *
 window_impl_rtb_alloc(void)
 {
+	struct headless_rutabaga *self;
+	EGLint major, minor;
+
+	if (!(self = calloc(1, sizeof(*self))))
+		goto err_malloc;
+
+	self->dpy = open_display();
+	if (self->dpy == EGL_NO_DISPLAY) {
+		ERR("can't get an EGL display\n");
+		goto err_dpy;
+	}
+
+	if (!eglInitialize(self->dpy, &major, &minor)) {
+		ERR("can't initialise EGL\n");
+		goto err_dpy;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		ERR("EGL display doesn't do desktop GL\n");
+		goto err_api;
+	}
+
+	if (find_config(self->dpy, &self->config)) {
+		ERR("no reasonable EGL configurations, bailing out\n");
+		goto err_api;
+	}
+
+	self->surfaceless =
+		has_egl_extension(self->dpy, "EGL_KHR_surfaceless_context");
+
+	return (struct rutabaga *) self;
+
+err_api:
+	eglTerminate(self->dpy);
+err_dpy:
+	free(self);
+err_malloc:
 	return NULL;
 }
 
 void
 window_impl_rtb_free(struct rutabaga *rtb)
 {
-	return;
+	struct headless_rutabaga *self = (void *) rtb;
+
+	eglTerminate(self->dpy);
+	eglReleaseThread();
+
+	free(self->clipboard.buffer);
+	free(self);
+}
+
+/**
+ * framebuffer
+ */
+
+static int
+framebuffer_init(struct headless_window *self, int w, int h)
+{
+	GLenum status;
+
+	glGenFramebuffers(1, &self->fbo);
+	glGenRenderbuffers(1, &self->color);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, self->color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			GL_RENDERBUFFER, self->color);
+	status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		ERR("framebuffer incomplete: 0x%x\n", status);
+		return -1;
+	}
+
+	RTB_WINDOW(self)->present.framebuffer = self->fbo;
+	return 0;
+}
+
+static void
+framebuffer_fini(struct headless_window *self)
+{
+	glDeleteFramebuffers(1, &self->fbo);
+	glDeleteRenderbuffers(1, &self->color);
+
+	self->fbo = self->color = 0;
+	RTB_WINDOW(self)->present.framebuffer = 0;
+}
+
+/**
+ * window
+ */
+
+static EGLContext
+new_gl_context(EGLDisplay dpy, EGLConfig config)
+{
+	EGLint attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+			EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+
+	return eglCreateContext(dpy, config, EGL_NO_CONTEXT, attribs);
+}
+
+int
+headless_window_make_current(struct headless_window *self)
+{
+	return !eglMakeCurrent(self->hrtb->dpy,
+			self->gl_surface, self->gl_surface, self->gl_ctx);
 }
 
 struct rtb_window *
-window_impl_open(struct rutabaga *r,
-		int width, int height, const char *title, intptr_t parent)
+window_impl_open(struct rutabaga *rtb,
+		int w, int h, const char *title, intptr_t parent)
 {
+	struct headless_rutabaga *hrtb = (void *) rtb;
+	struct headless_window *self;
+	EGLint pbuffer_attribs[] = {
+		EGL_WIDTH, 1,
+		EGL_HEIGHT, 1,
+		EGL_NONE
+	};
+
+	assert(rtb);
+	assert(h > 0);
+	assert(w > 0);
+
+	if (!(self = calloc(1, sizeof(*self))))
+		goto err_malloc;
+
+	self->hrtb = hrtb;
+	self->gl_surface = EGL_NO_SURFACE;
+
+	self->gl_ctx = new_gl_context(hrtb->dpy, hrtb->config);
+	if (self->gl_ctx == EGL_NO_CONTEXT) {
+		ERR("couldn't create EGL context\n");
+		goto err_gl_ctx;
+	}
+
+	/* we never draw to it, everything goes to our framebuffer. */
+	if (!hrtb->surfaceless) {
+		self->gl_surface = eglCreatePbufferSurface(hrtb->dpy,
+				hrtb->config, pbuffer_attribs);
+
+		if (self->gl_surface == EGL_NO_SURFACE) {
+			ERR("couldn't create pbuffer\n");
+			goto err_gl_surface;
+		}
+	}
+
+	if (headless_window_make_current(self)) {
+		ERR("couldn't activate EGL context\n");
+		goto err_make_current;
+	}
+
+	/* the core only loads GL once we've returned, and we need it for
+	 * the framebuffer. loading twice is harmless. */
+	if (ogl_LoadFunctions() == ogl_LOAD_FAILED) {
+		ERR("couldn't initialize openGL.\n");
+		goto err_load;
+	}
+
+	if (framebuffer_init(self, w, h))
+		goto err_framebuffer;
+
+	self->dpi.x = HEADLESS_DPI;
+	self->dpi.y = HEADLESS_DPI;
+
+	/* nothing ever swaps our framebuffer, so it always holds the last
+	 * frame and only damage needs repainting. */
+	self->present.mode = RTB_PRESENT_COPY_SUB_BUFFER;
+
+	/* there's no window system to tell us we've been mapped. */
+	self->need_reconfigure = 1;
+
+	uv_mutex_init(&self->lock);
+	uv_cond_init(&self->context.released);
+	return RTB_WINDOW(self);
+
+err_framebuffer:
+	framebuffer_fini(self);
+err_load:
+	eglMakeCurrent(hrtb->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			EGL_NO_CONTEXT);
+err_make_current:
+	if (self->gl_surface != EGL_NO_SURFACE)
+		eglDestroySurface(hrtb->dpy, self->gl_surface);
+err_gl_surface:
+	eglDestroyContext(hrtb->dpy, self->gl_ctx);
+err_gl_ctx:
+	free(self);
+err_malloc:
 	return NULL;
 }
 
 void
-window_impl_close(struct rtb_window *self)
+window_impl_close(struct rtb_window *rwin)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+	EGLDisplay dpy = self->hrtb->dpy;
+
+	framebuffer_fini(self);
+
+	eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (self->gl_surface != EGL_NO_SURFACE)
+		eglDestroySurface(dpy, self->gl_surface);
+	eglDestroyContext(dpy, self->gl_ctx);
+
+	uv_mutex_unlock(&self->lock);
+	uv_mutex_destroy(&self->lock);
+	uv_cond_destroy(&self->context.released);
+
+	free(self);
+}
+
+/**
+ * context ownership
+ */
+
+static void
+release_current(struct headless_window *self)
+{
+	eglMakeCurrent(self->hrtb->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			EGL_NO_CONTEXT);
+}
+
+static int
+on_owner_thread(struct headless_window *self)
+{
+	uv_thread_t this_thread = uv_thread_self();
+
+	return self->context.owned
+		&& uv_thread_equal(&self->context.owner, &this_thread);
+}
+
+static void
+handoff_cb(uv_async_t *handle)
 {
-	return;
+	struct headless_window *self =
+		RTB_CONTAINER_OF(handle, struct headless_window, context.handoff);
+
+	uv_mutex_lock(&self->lock);
+
+	if (self->context.current) {
+		release_current(self);
+		self->context.current = 0;
+	}
+
+	uv_cond_broadcast(&self->context.released);
+	uv_mutex_unlock(&self->lock);
+}
+
+void
+headless_window_own_context(struct headless_window *self, uv_loop_t *loop)
+{
+	uv_async_init(loop, &self->context.handoff, handoff_cb);
+
+	uv_mutex_lock(&self->lock);
+
+	self->context.owner = uv_thread_self();
+	self->context.owned = 1;
+	self->context.current = 0;
+
+	uv_mutex_unlock(&self->lock);
+}
+
+void
+headless_window_disown_context(struct headless_window *self)
+{
+	uv_mutex_lock(&self->lock);
+
+	if (self->context.current)
+		release_current(self);
+
+	self->context.owned = 0;
+	self->context.current = 0;
+
+	uv_cond_broadcast(&self->context.released);
+	uv_mutex_unlock(&self->lock);
+
+	uv_close((void *) &self->context.handoff, NULL);
+}
+
+void
+rtb_window_lock(struct rtb_window *rwin)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+
+	uv_mutex_lock(&self->lock);
+
+	if (on_owner_thread(self)) {
+		if (!self->context.current) {
+			headless_window_make_current(self);
+			self->context.current = 1;
+		}
+
+		return;
+	}
+
+	while (self->context.owned && self->context.current) {
+		uv_async_send(&self->context.handoff);
+		uv_cond_wait(&self->context.released, &self->lock);
+	}
+
+	headless_window_make_current(self);
+}
+
+void
+rtb_window_unlock(struct rtb_window *rwin)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+
+	if (!on_owner_thread(self))
+		release_current(self);
+
+	uv_mutex_unlock(&self->lock);
+}
+
+/**
+ * public API
+ */
+
+int
+rtb_headless_read_pixels(struct rtb_window *rwin, void *pixels)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+	unsigned char *row, *top, *bottom;
+	int y, w = rwin->w, h = rwin->h;
+	size_t stride = w * 4;
+
+	if (!(row = malloc(stride)))
+		return -1;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	/* GL hands them over bottom row first. */
+	for (y = 0; y < h / 2; y++) {
+		top = (unsigned char *) pixels + y * stride;
+		bottom = (unsigned char *) pixels + (h - 1 - y) * stride;
+
+		memcpy(row, top, stride);
+		memcpy(top, bottom, stride);
+		memcpy(bottom, row, stride);
+	}
+
+	free(row);
+
+	/* we went around the state tracker's back. */
+	rtb_render_state_invalidate(&rwin->local_storage.state);
+	return 0;
+}
+
+int
+rtb_headless_resize(struct rtb_window *rwin, int w, int h)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+
+	if (w <= 0 || h <= 0)
+		return -1;
+
+	if (w == rwin->w && h == rwin->h)
+		return 0;
+
+	framebuffer_fini(self);
+	if (framebuffer_init(self, w, h))
+		return -1;
+
+	rtb_render_state_invalidate(&rwin->local_storage.state);
+
+	rwin->w = w;
+	rwin->h = h;
+	rwin->need_reconfigure = 1;
+	rtb_window_mark_exposed(rwin);
+
+	return 0;
 }
@@ -61,6 +61,12 @@ draw_frame(struct win_rtb_window *self, int force)
 	UNLOCK(self);
 }
 
+void
+rtb__platform_request_frame(struct rtb_window *win)
+{
+	/* the frame timer ticks regardless here. */
+}
+
 /**
  * window events
  */
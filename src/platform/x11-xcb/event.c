@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 
@@ -52,11 +53,6 @@
 
 #include "xrtb.h"
 
-#ifndef GL_ARB_timer_query
-#define GL_TIME_ELAPSED 0x88BF
-#define GL_TIMESTAMP 0x8E28
-#endif
-
 #define CAST_EVENT_TO(type) type *ev = (type *) _ev
 #define SET_IF_TRUE(w, m, f) (w = (w & ~m) | (-f & m))
 
@@ -165,6 +161,54 @@ handle_mouse_motion(struct xrtb_window *win, const xcb_generic_event_t *_ev)
 	rtb__platform_mouse_motion(RTB_WINDOW(win), ev->event_x, ev->event_y);
 }
 
+/**
+ * a run of motion events with nothing in between gets dispatched as just
+ * the last one. drag deltas are taken against the previous position we
+ * dispatched, so they add up to the same thing.
+ */
+
+static int
+can_coalesce_motion(const xcb_motion_notify_event_t *a,
+		const xcb_motion_notify_event_t *b)
+{
+	return a->event == b->event
+		&& a->state == b->state
+		&& a->same_screen == b->same_screen;
+}
+
+static void
+remember_coalesced_motion(struct xrtb_window *win,
+		const xcb_motion_notify_event_t *ev)
+{
+	struct rtb_mouse *m = &RTB_WINDOW(win)->mouse;
+
+	if (m->coalesced.count == RTB_MOUSE_MOTION_HISTORY) {
+		memmove(m->coalesced.points, m->coalesced.points + 1,
+				(RTB_MOUSE_MOTION_HISTORY - 1)
+				* sizeof(*m->coalesced.points));
+		m->coalesced.count--;
+	}
+
+	m->coalesced.points[m->coalesced.count++] = (struct rtb_point) {
+		.x = ev->event_x,
+		.y = ev->event_y
+	};
+}
+
+static void
+flush_coalesced_motion(struct xrtb_window *win,
+		xcb_motion_notify_event_t **pending)
+{
+	if (!*pending)
+		return;
+
+	handle_mouse_motion(win, (xcb_generic_event_t *) *pending);
+	RTB_WINDOW(win)->mouse.coalesced.count = 0;
+
+	free(*pending);
+	*pending = NULL;
+}
+
 /**
  * keyboard events
  */
@@ -230,6 +274,7 @@ static void
 handle_visibility_notify(struct xrtb_window *win, xcb_generic_event_t *_ev)
 {
 	CAST_EVENT_TO(xcb_visibility_notify_event_t);
+	int was_obscured = (win->visibility == RTB_FULLY_OBSCURED);
 
 	switch (ev->state) {
 	case XCB_VISIBILITY_UNOBSCURED:
@@ -244,8 +289,29 @@ handle_visibility_notify(struct xrtb_window *win, xcb_generic_event_t *_ev)
 		win->visibility = RTB_FULLY_OBSCURED;
 		break;
 	}
+
+	/* the frame clock stops while we're hidden, and whatever got marked
+	 * dirty in the meantime is still waiting. */
+	if (was_obscured && win->visibility != RTB_FULLY_OBSCURED)
+		rtb__platform_request_frame(RTB_WINDOW(win));
 }
 
+static void
+handle_expose(struct xrtb_window *win, xcb_generic_event_t *_ev)
+{
+	CAST_EVENT_TO(xcb_expose_event_t);
+
+	/* exposes come in batches, one per rectangle, with `count` saying
+	 * how many more are on their way. we repaint the whole window on
+	 * the last one anyway. */
+	if (ev->count)
+		return;
+
+	rtb_window_mark_exposed(RTB_WINDOW(win));
+}
+
+/* configure notifies only record the newest size. the window is
+ * reflowed once, at the end of the drain. */
 static void
 handle_configure_notify(struct xrtb_window *win, xcb_generic_event_t *_ev)
 {
@@ -490,7 +556,7 @@ handle_generic_event(struct xrtb_window *win, xcb_generic_event_t *ev)
 		break;
 
 	case XCB_EXPOSE:
-		win->dirty = 1;
+		handle_expose(win, ev);
 		break;
 
 	case XCB_VISIBILITY_NOTIFY:
@@ -535,21 +601,42 @@ handle_generic_event(struct xrtb_window *win, xcb_generic_event_t *ev)
 static int
 drain_xcb_event_queue(xcb_connection_t *conn, struct rtb_window *win)
 {
+	struct xrtb_window *xwin = RTB_WINDOW_AS(win, xrtb_window);
+	xcb_motion_notify_event_t *motion, *pending_motion;
 	xcb_generic_event_t *ev;
 	int ret, nevents;
 
+	pending_motion = NULL;
 	nevents = 0;
 
 	while ((ev = xcb_poll_for_event(conn))) {
-		ret = handle_generic_event(RTB_WINDOW_AS(win, xrtb_window), ev);
 		nevents++;
 
+		if ((ev->response_type & ~0x80) == XCB_MOTION_NOTIFY) {
+			motion = (xcb_motion_notify_event_t *) ev;
+
+			if (pending_motion
+					&& can_coalesce_motion(pending_motion, motion)) {
+				remember_coalesced_motion(xwin, pending_motion);
+				free(pending_motion);
+			} else
+				flush_coalesced_motion(xwin, &pending_motion);
+
+			pending_motion = motion;
+			continue;
+		}
+
+		flush_coalesced_motion(xwin, &pending_motion);
+
+		ret = handle_generic_event(xwin, ev);
 		free(ev);
 
 		if (ret)
 			return -1;
 	}
 
+	flush_coalesced_motion(xwin, &pending_motion);
+
 	if (win->need_reconfigure) {
 		rtb_window_reinit(win);
 		win->need_reconfigure = 0;
@@ -578,34 +665,79 @@ xcb_poll_cb(uv_poll_t *_handle, int status, int events)
 	rtb_window_unlock(win);
 }
 
+static void frame_cb(uv_timer_t *);
+
+static void
+schedule_frame(struct xrtb_frame_clock *clock)
+{
+	uint64_t now, next, delay;
+
+	if (clock->scheduled)
+		return;
+
+	/* we sleep until just about the next refresh. if the swap interval
+	 * is honoured, presenting blocks for the rest of the way. */
+	now = uv_hrtime();
+	next = clock->last_frame + clock->period;
+	delay = (next > now) ? (next - now) / 1000000 : 0;
+
+	uv_timer_start(RTB_UPCAST(clock, uv_timer_s), frame_cb, delay, 0);
+	clock->scheduled = 1;
+}
+
 static void
 frame_cb(uv_timer_t *_handle)
 {
-	struct xrtb_frame_timer *timer;
+	struct xrtb_frame_clock *clock;
 	struct xrtb_window *xwin;
 	struct rtb_window *win;
 
-	timer = RTB_DOWNCAST(_handle, xrtb_frame_timer, uv_timer_s);
-	xwin = timer->xwin;
+	clock = RTB_DOWNCAST(_handle, xrtb_frame_clock, uv_timer_s);
+	xwin = clock->xwin;
 	win = RTB_WINDOW(xwin);
 
+	clock->scheduled = 0;
+
 	rtb_window_lock(win);
 	drain_xcb_event_queue(xwin->xrtb->xcb_conn, win);
 
+	xrtb_window_prepare_frame(xwin);
+	win->present.frame_time = uv_hrtime();
+
 	if (rtb_window_draw(win, 0))
-		glXSwapBuffers(xwin->xrtb->dpy, xwin->gl_draw);
+		xrtb_window_present(xwin);
+
+	clock->last_frame = uv_hrtime();
 
 	drain_xcb_event_queue(xwin->xrtb->xcb_conn, win);
+
+	if (rtb_window_wants_frame(win))
+		schedule_frame(clock);
+
 	rtb_window_unlock(win);
 }
 
-static int
-frame_timer_init(struct xrtb_frame_timer *timer)
+static void
+wake_cb(uv_async_t *handle)
 {
-	/* FIXME: get FPS from xrandr? or xcomposite? whatever. */
+	struct xrtb_frame_clock *clock =
+		RTB_CONTAINER_OF(handle, struct xrtb_frame_clock, wake);
 
-	timer->wait_msec = 15;
-	return 0;
+	schedule_frame(clock);
+}
+
+void
+rtb__platform_request_frame(struct rtb_window *win)
+{
+	struct xrtb_frame_clock *clock;
+
+	clock = &RTB_WINDOW_AS(win, xrtb_window)->xrtb->frame_clock;
+
+	/* the first frame is scheduled when the loop starts, and uv_async
+	 * is the only part of libuv that's safe to poke from other
+	 * threads. */
+	if (clock->running)
+		uv_async_send(&clock->wake);
 }
 
 void
@@ -613,19 +745,27 @@ rtb_event_loop_init(struct rutabaga *r)
 {
 	struct xcb_rutabaga *xrtb = (void *) r;
 	struct xrtb_window *xwin = (void *) r->win;
+	struct xrtb_frame_clock *clock = &xrtb->frame_clock;
 
 	xrtb->xcb_poll.xrtb = xrtb;
 	uv_poll_init(&r->event_loop, RTB_UPCAST(&xrtb->xcb_poll, uv_poll_s),
 			xcb_get_file_descriptor(xrtb->xcb_conn));
 
-	xrtb->frame_timer.xwin = xwin;
-	frame_timer_init(&xrtb->frame_timer);
-	uv_timer_init(&r->event_loop, RTB_UPCAST(&xrtb->frame_timer, uv_timer_s));
+	clock->xwin = xwin;
+	clock->period = xwin->refresh_period;
+	clock->last_frame = 0;
+	clock->scheduled = 0;
+
+	uv_timer_init(&r->event_loop, RTB_UPCAST(clock, uv_timer_s));
+	uv_async_init(&r->event_loop, &clock->wake, wake_cb);
 
 	uv_poll_start(RTB_UPCAST(&xrtb->xcb_poll, uv_poll_s), UV_READABLE,
 			xcb_poll_cb);
-	uv_timer_start(RTB_UPCAST(&xrtb->frame_timer, uv_timer_s),
-			frame_cb, 0, xrtb->frame_timer.wait_msec);
+
+	xrtb_window_own_context(xwin, &r->event_loop);
+
+	clock->running = 1;
+	schedule_frame(clock);
 }
 
 void
@@ -645,7 +785,11 @@ rtb_event_loop_fini(struct rutabaga *r)
 {
 	struct xcb_rutabaga *xrtb = (void *) r;
 
-	uv_close((void *) RTB_UPCAST(&xrtb->frame_timer, uv_timer_s), NULL);
+	xrtb->frame_clock.running = 0;
+	xrtb_window_disown_context((struct xrtb_window *) r->win);
+
+	uv_close((void *) &xrtb->frame_clock.wake, NULL);
+	uv_close((void *) RTB_UPCAST(&xrtb->frame_clock, uv_timer_s), NULL);
 	uv_close((void *) RTB_UPCAST(&xrtb->xcb_poll, uv_poll_s), NULL);
 
 	uv_run(&r->event_loop, UV_RUN_NOWAIT);
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
 #include <uv.h>
 
@@ -44,6 +45,10 @@
 #include <GL/glx.h>
 #include <GL/glxext.h>
 
+#ifndef GLX_BACK_BUFFER_AGE_EXT
+#define GLX_BACK_BUFFER_AGE_EXT 0x20F4
+#endif
+
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/window.h>
 #include <rutabaga/mouse.h>
@@ -492,6 +497,67 @@ set_swap_interval(Display *dpy, GLXDrawable drawable)
 	swap_interval(dpy, drawable, 1);
 }
 
+static int
+has_glx_extension(Display *dpy, int screen, const char *name)
+{
+	const char *exts;
+	size_t len;
+
+	exts = glXQueryExtensionsString(dpy, screen);
+	len = strlen(name);
+
+	for (; exts && (exts = strstr(exts, name)); exts += len)
+		if (exts[len] == ' ' || exts[len] == '\0')
+			return 1;
+
+	return 0;
+}
+
+static void
+pick_present_mode(struct xrtb_window *self, Display *dpy, int screen)
+{
+	struct rtb_window *win = RTB_WINDOW(self);
+
+	if (has_glx_extension(dpy, screen, "GLX_EXT_buffer_age")) {
+		win->present.mode = RTB_PRESENT_BUFFER_AGE;
+		return;
+	}
+
+	self->copy_sub_buffer =
+		(void *) glXGetProcAddress((GLubyte *) "glXCopySubBufferMESA");
+
+	if (self->copy_sub_buffer
+			&& has_glx_extension(dpy, screen, "GLX_MESA_copy_sub_buffer")) {
+		win->present.mode = RTB_PRESENT_COPY_SUB_BUFFER;
+		return;
+	}
+
+	win->present.mode = RTB_PRESENT_FULL;
+}
+
+static void
+query_refresh_period(struct xrtb_window *self, Display *dpy, int screen)
+{
+	PFNGLXGETMSCRATEOMLPROC get_msc_rate;
+	int32_t numerator, denominator;
+
+	self->refresh_period = XRTB_DEFAULT_REFRESH_NSEC;
+
+	if (!has_glx_extension(dpy, screen, "GLX_OML_sync_control"))
+		return;
+
+	get_msc_rate = (void *)
+		glXGetProcAddress((GLubyte *) "glXGetMscRateOML");
+
+	if (!get_msc_rate
+			|| !get_msc_rate(dpy, self->gl_draw, &numerator, &denominator)
+			|| numerator <= 0 || denominator <= 0)
+		return;
+
+	self->refresh_period =
+		(1000000000ull * (uint64_t) denominator) / (uint64_t) numerator;
+}
+
 static void
 raise_window(xcb_connection_t *xcb_conn, xcb_window_t window)
 {
@@ -642,6 +708,8 @@ window_impl_open(struct rutabaga *rtb,
 	}
 
 	set_swap_interval(dpy, self->gl_draw);
+	pick_present_mode(self, dpy, default_screen);
+	query_refresh_period(self, dpy, default_screen);
 
 	ck_map = xcb_map_window_checked(xcb_conn, self->xcb_win);
 	if ((err = xcb_request_check(xcb_conn, ck_map))) {
@@ -659,6 +727,7 @@ window_impl_open(struct rutabaga *rtb,
 	free(fb_configs);
 
 	uv_mutex_init(&self->lock);
+	uv_cond_init(&self->context.released);
 	return RTB_WINDOW(self);
 
 err_win_map:
@@ -692,21 +761,161 @@ window_impl_close(struct rtb_window *rwin)
 
 	uv_mutex_unlock(&self->lock);
 	uv_mutex_destroy(&self->lock);
+	uv_cond_destroy(&self->context.released);
 
 	xcb_cursor_context_free(self->cursor_ctx);
 
 	free(self);
 }
 
+void
+xrtb_window_prepare_frame(struct xrtb_window *self)
+{
+	struct rtb_window *win = RTB_WINDOW(self);
+	unsigned int age;
+
+	if (win->present.mode != RTB_PRESENT_BUFFER_AGE)
+		return;
+
+	age = 0;
+	glXQueryDrawable(self->xrtb->dpy, self->gl_draw,
+			GLX_BACK_BUFFER_AGE_EXT, &age);
+
+	win->present.buffer_age = age;
+}
+
+void
+xrtb_window_present(struct xrtb_window *self)
+{
+	struct rtb_window *win = RTB_WINDOW(self);
+	const struct rtb_rect *damage = &win->present.damage;
+	int x, y, x2, y2;
+
+	if (win->present.mode != RTB_PRESENT_COPY_SUB_BUFFER) {
+		glXSwapBuffers(self->xrtb->dpy, self->gl_draw);
+		return;
+	}
+
+	if (rtb_rect_is_empty(damage))
+		return;
+
+	/* GLX counts from the bottom left. */
+	x  = floorf(damage->x);
+	x2 = ceilf(damage->x2);
+	y  = win->h - ceilf(damage->y2);
+	y2 = win->h - floorf(damage->y);
+
+	self->copy_sub_buffer(self->xrtb->dpy, self->gl_draw,
+			x, y, x2 - x, y2 - y);
+}
+
+/**
+ * context ownership
+ *
+ * making a context current is expensive on a lot of drivers, so while the
+ * event loop is running, its thread makes ours current once and keeps it
+ * that way. taking the window lock there is just a mutex.
+ *
+ * any other thread that takes the lock has to wait for the loop thread to
+ * let go of the context (which it does from `handoff`), makes it current
+ * for as long as it holds the lock, and releases it again on the way out.
+ * it's slow, but it's also rare.
+ */
+
+static void
+make_current(struct xrtb_window *self)
+{
+	glXMakeContextCurrent(
+			self->xrtb->dpy, self->gl_draw, self->gl_draw, self->gl_ctx);
+}
+
+static void
+release_current(struct xrtb_window *self)
+{
+	glXMakeContextCurrent(self->xrtb->dpy, None, None, NULL);
+}
+
+static int
+on_owner_thread(struct xrtb_window *self)
+{
+	uv_thread_t this_thread = uv_thread_self();
+
+	return self->context.owned
+		&& uv_thread_equal(&self->context.owner, &this_thread);
+}
+
+static void
+handoff_cb(uv_async_t *handle)
+{
+	struct xrtb_window *self =
+		RTB_CONTAINER_OF(handle, struct xrtb_window, context.handoff);
+
+	uv_mutex_lock(&self->lock);
+
+	if (self->context.current) {
+		release_current(self);
+		self->context.current = 0;
+	}
+
+	uv_cond_broadcast(&self->context.released);
+	uv_mutex_unlock(&self->lock);
+}
+
+void
+xrtb_window_own_context(struct xrtb_window *self, uv_loop_t *loop)
+{
+	uv_async_init(loop, &self->context.handoff, handoff_cb);
+
+	uv_mutex_lock(&self->lock);
+
+	self->context.owner = uv_thread_self();
+	self->context.owned = 1;
+	self->context.current = 0;
+
+	uv_mutex_unlock(&self->lock);
+}
+
+void
+xrtb_window_disown_context(struct xrtb_window *self)
+{
+	uv_mutex_lock(&self->lock);
+
+	if (self->context.current)
+		release_current(self);
+
+	self->context.owned = 0;
+	self->context.current = 0;
+
+	/* anybody still waiting on a handoff would wait forever. */
+	uv_cond_broadcast(&self->context.released);
+	uv_mutex_unlock(&self->lock);
+
+	uv_close((void *) &self->context.handoff, NULL);
+}
+
 void
 rtb_window_lock(struct rtb_window *rwin)
 {
 	struct xrtb_window *self = RTB_WINDOW_AS(rwin, xrtb_window);
 
 	uv_mutex_lock(&self->lock);
+
+	if (on_owner_thread(self)) {
+		if (!self->context.current) {
+			make_current(self);
+			self->context.current = 1;
+		}
+
+		return;
+	}
+
+	while (self->context.owned && self->context.current) {
+		uv_async_send(&self->context.handoff);
+		uv_cond_wait(&self->context.released, &self->lock);
+	}
+
 	XLockDisplay(self->xrtb->dpy);
-	glXMakeContextCurrent(
-				self->xrtb->dpy, self->gl_draw, self->gl_draw, self->gl_ctx);
+	make_current(self);
 }
 
 void
@@ -714,7 +923,10 @@ rtb_window_unlock(struct rtb_window *rwin)
 {
 	struct xrtb_window *self = RTB_WINDOW_AS(rwin, xrtb_window);
 
-	glXMakeContextCurrent(self->xrtb->dpy, None, None, NULL);
-	XUnlockDisplay(self->xrtb->dpy);
+	if (!on_owner_thread(self)) {
+		release_current(self);
+		XUnlockDisplay(self->xrtb->dpy);
+	}
+
 	uv_mutex_unlock(&self->lock);
 }
@@ -38,10 +38,24 @@
 
 #define ERR(...) fprintf(stderr, "rutabaga XCB: " __VA_ARGS__)
 
-struct xrtb_frame_timer {
+/* refresh period to pace frames to when the server won't tell us one */
+#define XRTB_DEFAULT_REFRESH_NSEC (1000000000 / 60)
+
+/**
+ * one-shot timer for the next frame. it's only armed while the window
+ * wants frames, and sleeps otherwise until `wake` is sent.
+ */
+struct xrtb_frame_clock {
 	RTB_INHERIT(uv_timer_s);
+	uv_async_t wake;
+
 	struct xrtb_window *xwin;
-	unsigned int wait_msec;
+
+	uint64_t period;
+	uint64_t last_frame;
+
+	int scheduled;
+	int running;
 };
 
 struct xrtb_uv_poll {
@@ -85,7 +99,7 @@ struct xcb_rutabaga {
 	xcb_cursor_t empty_cursor;
 
 	struct xrtb_uv_poll xcb_poll;
-	struct xrtb_frame_timer frame_timer;
+	struct xrtb_frame_clock frame_clock;
 
 	struct {
 		xcb_connection_t *conn;
@@ -109,12 +123,37 @@ struct xrtb_window {
 	GLXContext gl_ctx;
 	GLXWindow gl_win;
 
+	/* glXCopySubBufferMESA, for RTB_PRESENT_COPY_SUB_BUFFER */
+	void (*copy_sub_buffer)(Display *, GLXDrawable,
+			int x, int y, int w, int h);
+
+	/* nanoseconds between vertical refreshes */
+	uint64_t refresh_period;
+
+	/* while the event loop runs, its thread keeps the context current
+	 * for good and other threads borrow it through `handoff`. see
+	 * rtb_window_lock(). */
+	struct {
+		uv_thread_t owner;
+		int owned;
+		int current;
+
+		uv_async_t handoff;
+		uv_cond_t released;
+	} context;
+
 	uint16_t numlock_mask;
 	uint16_t capslock_mask;
 	uint16_t shiftlock_mask;
 	uint16_t modeswitch_mask;
 };
 
+void xrtb_window_own_context(struct xrtb_window *, uv_loop_t *);
+void xrtb_window_disown_context(struct xrtb_window *);
+
+void xrtb_window_prepare_frame(struct xrtb_window *);
+void xrtb_window_present(struct xrtb_window *);
+
 rtb_keysym_t xrtb_keyboard_translate_keysym(xcb_keysym_t xsym,
 		rtb_utf32_t *chr);
 
@@ -0,0 +1,363 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/profiler.h>
+
+#define HISTORY     RTB_PROFILER_HISTORY
+#define LATENCY     RTB_PROFILER_LATENCY
+#define MAX_QUERIES RTB_PROFILER_MAX_QUERIES
+#define MAX_DEPTH   RTB_PROFILER_MAX_DEPTH
+
+static const char *zone_names[RTB_PROFILE_ZONE_COUNT] = {
+	[RTB_PROFILE_FRAME]   = "frame",
+	[RTB_PROFILE_SURFACE] = "surface",
+	[RTB_PROFILE_BLIT]    = "blit",
+	[RTB_PROFILE_ELEMENT] = "element",
+	[RTB_PROFILE_REFLOW]  = "reflow",
+	[RTB_PROFILE_RESTYLE] = "restyle"
+};
+
+static int
+zone_is_gpu_timed(rtb_profile_zone_t zone)
+{
+	switch (zone) {
+	case RTB_PROFILE_FRAME:
+	case RTB_PROFILE_SURFACE:
+	case RTB_PROFILE_BLIT:
+		return 1;
+
+	default:
+		return 0;
+	}
+}
+
+static int
+is_recording(struct rtb_profiler *self, rtb_profile_zone_t zone)
+{
+	if (!self->enabled)
+		return 0;
+
+	if (zone == RTB_PROFILE_ELEMENT)
+		return !!(self->flags & RTB_PROFILER_ELEMENTS);
+
+	return 1;
+}
+
+static struct rtb_profiler_slot *
+current_slot(struct rtb_profiler *self)
+{
+	return &self->slots[self->serial % LATENCY];
+}
+
+/**
+ * reading back GPU timestamps
+ */
+
+static int
+slot_is_ready(struct rtb_profiler_slot *slot)
+{
+	GLint available = 0;
+
+	/* the frame zone's end timestamp is the last one we asked for. */
+	glGetQueryObjectiv(slot->queries[1],
+			GL_QUERY_RESULT_AVAILABLE, &available);
+
+	return available;
+}
+
+static void
+collect(struct rtb_profiler *self, struct rtb_profiler_slot *slot)
+{
+	struct rtb_profile_frame *frame;
+	GLuint64 begin, end;
+	int64_t excl[MAX_QUERIES];
+	uint64_t incl[MAX_QUERIES];
+	int i, parent;
+
+	slot->pending = 0;
+
+	for (i = 0; i < slot->nzones; i++) {
+		glGetQueryObjectui64v(slot->queries[i * 2],
+				GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(slot->queries[i * 2 + 1],
+				GL_QUERY_RESULT, &end);
+
+		incl[i] = (end > begin) ? end - begin : 0;
+		excl[i] = incl[i];
+	}
+
+	for (i = 0; i < slot->nzones; i++) {
+		parent = slot->zones[i].parent;
+		if (parent >= 0)
+			excl[parent] -= incl[i];
+	}
+
+	/* it's been so long that the frame has fallen out of the history. */
+	frame = &self->frames[slot->serial % HISTORY];
+	if (frame->serial != slot->serial)
+		return;
+
+	for (i = 0; i < slot->nzones; i++)
+		if (excl[i] > 0)
+			frame->zones[slot->zones[i].zone].gpu_ns += excl[i];
+
+	frame->gpu_ns = incl[0];
+	frame->gpu_valid = 1;
+}
+
+static void
+collect_finished(struct rtb_profiler *self)
+{
+	struct rtb_profiler_slot *slot;
+	int i;
+
+	for (i = 0; i < LATENCY; i++) {
+		slot = &self->slots[i];
+
+		if (slot->pending && slot_is_ready(slot))
+			collect(self, slot);
+	}
+}
+
+/**
+ * public API
+ */
+
+void
+rtb_profiler_begin_frame(struct rtb_profiler *self)
+{
+	struct rtb_profiler_slot *slot;
+
+	if (!self->enabled)
+		return;
+
+	if (self->have_timer_query) {
+		collect_finished(self);
+
+		/* only if the GPU is more than LATENCY frames behind. */
+		slot = current_slot(self);
+		if (slot->pending)
+			collect(self, slot);
+
+		slot->serial = self->serial;
+		slot->nzones = 0;
+	}
+
+	self->in_frame = 1;
+	rtb_profiler_begin(self, RTB_PROFILE_FRAME);
+
+	if (self->frame_cb)
+		self->frame_cb(self, self->frame_ctx);
+}
+
+void
+rtb_profiler_end_frame(struct rtb_profiler *self)
+{
+	struct rtb_profile_frame *frame;
+	struct rtb_profiler_slot *slot;
+
+	if (!self->enabled || !self->in_frame)
+		return;
+
+	rtb_profiler_end(self, RTB_PROFILE_FRAME);
+	self->in_frame = 0;
+
+	if (self->have_timer_query) {
+		slot = current_slot(self);
+		slot->pending = (slot->nzones > 0);
+	}
+
+	frame = &self->frames[self->serial % HISTORY];
+	*frame = self->current;
+	frame->serial = self->serial;
+	frame->gpu_ns = 0;
+	frame->gpu_valid = 0;
+
+	memset(&self->current, 0, sizeof(self->current));
+	self->serial++;
+}
+
+void
+rtb_profiler_begin(struct rtb_profiler *self, rtb_profile_zone_t zone)
+{
+	struct rtb_profiler_slot *slot;
+	int i, gpu = -1;
+
+	if (!is_recording(self, zone))
+		return;
+
+	if (self->stack.depth == MAX_DEPTH) {
+		self->stack.overflow++;
+		return;
+	}
+
+	if (self->in_frame && self->have_timer_query
+			&& zone_is_gpu_timed(zone)) {
+		slot = current_slot(self);
+
+		if (slot->nzones < MAX_QUERIES) {
+			gpu = slot->nzones++;
+			slot->zones[gpu].zone = zone;
+			slot->zones[gpu].parent = -1;
+
+			for (i = self->stack.depth - 1; i >= 0; i--) {
+				if (self->stack.entries[i].gpu >= 0) {
+					slot->zones[gpu].parent = self->stack.entries[i].gpu;
+					break;
+				}
+			}
+
+			glQueryCounter(slot->queries[gpu * 2], GL_TIMESTAMP);
+		}
+	}
+
+	i = self->stack.depth++;
+	self->stack.entries[i].zone = zone;
+	self->stack.entries[i].children = 0;
+	self->stack.entries[i].gpu = gpu;
+	self->stack.entries[i].begin = uv_hrtime();
+}
+
+void
+rtb_profiler_end(struct rtb_profiler *self, rtb_profile_zone_t zone)
+{
+	struct rtb_profile_times *times;
+	uint64_t now, incl;
+	int i;
+
+	if (!is_recording(self, zone))
+		return;
+
+	if (self->stack.overflow) {
+		self->stack.overflow--;
+		return;
+	}
+
+	/* we were enabled partway through this zone. */
+	i = self->stack.depth - 1;
+	if (i < 0 || self->stack.entries[i].zone != zone)
+		return;
+
+	now = uv_hrtime();
+	self->stack.depth = i;
+
+	if (self->stack.entries[i].gpu >= 0)
+		glQueryCounter(current_slot(self)->queries[
+				self->stack.entries[i].gpu * 2 + 1], GL_TIMESTAMP);
+
+	incl = now - self->stack.entries[i].begin;
+
+	times = &self->current.zones[zone];
+	times->cpu_ns += incl - self->stack.entries[i].children;
+	times->count++;
+
+	if (i > 0)
+		self->stack.entries[i - 1].children += incl;
+
+	if (zone == RTB_PROFILE_FRAME)
+		self->current.cpu_ns = incl;
+}
+
+const struct rtb_profile_frame *
+rtb_profiler_get_frame(struct rtb_profiler *self, unsigned int ago)
+{
+	if (ago >= HISTORY || ago >= self->serial)
+		return NULL;
+
+	return &self->frames[(self->serial - 1 - ago) % HISTORY];
+}
+
+const char *
+rtb_profiler_zone_name(rtb_profile_zone_t zone)
+{
+	if (zone >= RTB_PROFILE_ZONE_COUNT)
+		return NULL;
+
+	return zone_names[zone];
+}
+
+void
+rtb_profiler_enable(struct rtb_profiler *self, int enabled)
+{
+	int i;
+
+	if (self->enabled == !!enabled)
+		return;
+
+	self->enabled = !!enabled;
+
+	/* anything in flight from before was never finished. */
+	self->stack.depth = 0;
+	self->stack.overflow = 0;
+	self->in_frame = 0;
+
+	for (i = 0; i < LATENCY; i++)
+		self->slots[i].pending = 0;
+
+	memset(&self->current, 0, sizeof(self->current));
+}
+
+void
+rtb_profiler_set_flags(struct rtb_profiler *self, unsigned int flags)
+{
+	self->flags = flags;
+}
+
+int
+rtb_profiler_init(struct rtb_profiler *self)
+{
+	int i;
+
+	memset(self, 0, sizeof(*self));
+
+	/* core in 3.3, so we have to ask for it. without it we only keep
+	 * CPU times. */
+	self->have_timer_query =
+		(ogl_ext_ARB_timer_query == ogl_LOAD_SUCCEEDED);
+
+	if (!self->have_timer_query)
+		return 0;
+
+	for (i = 0; i < LATENCY; i++)
+		glGenQueries(MAX_QUERIES * 2, self->slots[i].queries);
+
+	return 0;
+}
+
+void
+rtb_profiler_fini(struct rtb_profiler *self)
+{
+	int i;
+
+	if (!self->have_timer_query)
+		return;
+
+	for (i = 0; i < LATENCY; i++)
+		glDeleteQueries(MAX_QUERIES * 2, self->slots[i].queries);
+}
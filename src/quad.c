@@ -25,8 +25,22 @@
  */
 
 #include <rutabaga/rutabaga.h>
+#include <rutabaga/shader.h>
 #include <rutabaga/quad.h>
 
+static void
+attach_buffer(struct rtb_quad *self, GLuint attrib, GLuint buffer)
+{
+	glBindVertexArray(self->vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glEnableVertexAttribArray(attrib);
+	glVertexAttribPointer(attrib, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(0);
+}
+
 void
 rtb_quad_set_vertices(struct rtb_quad *self, struct rtb_rect *from)
 {
@@ -40,6 +54,8 @@ rtb_quad_set_vertices(struct rtb_quad *self, struct rtb_rect *from)
 	glBindBuffer(GL_ARRAY_BUFFER, self->vertices);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	attach_buffer(self, RTB_SHADER_ATTRIB_VERTEX, self->vertices);
 }
 
 void
@@ -52,8 +68,10 @@ rtb_quad_set_tex_coords(struct rtb_quad *self, struct rtb_rect *from)
 		{from->x,  from->y2}
 	};
 
-	if (!self->tex_coords)
+	if (!self->tex_coords) {
 		glGenBuffers(1, &self->tex_coords);
+		attach_buffer(self, RTB_SHADER_ATTRIB_TEX_COORD, self->tex_coords);
+	}
 
 	glBindBuffer(GL_ARRAY_BUFFER, self->tex_coords);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
@@ -64,6 +82,7 @@ void
 rtb_quad_init(struct rtb_quad *self)
 {
 	glGenBuffers(1, &self->vertices);
+	glGenVertexArrays(1, &self->vao);
 	self->tex_coords = 0;
 }
 
@@ -74,4 +93,6 @@ rtb_quad_fini(struct rtb_quad *self)
 
 	FREE_BUFFER_IF_USED(tex_coords);
 	FREE_BUFFER_IF_USED(vertices);
+
+	glDeleteVertexArrays(1, &self->vao);
 }
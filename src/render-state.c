@@ -0,0 +1,227 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/render-state.h>
+#include <rutabaga/shader.h>
+
+#define UNKNOWN ((GLuint) -1)
+
+#define ISSUE_UNLESS(same) do {												\
+	if (same) {																\
+		self->stats.elided++;												\
+		return 0;															\
+	}																		\
+																			\
+	self->stats.issued++;													\
+} while (0)
+
+/**
+ * public API
+ */
+
+void
+rtb_render_state_invalidate(struct rtb_render_state *self)
+{
+	int i;
+
+	self->program        = UNKNOWN;
+	self->framebuffer    = UNKNOWN;
+	self->frame_uniforms = UNKNOWN;
+
+	self->viewport.w = -1;
+	self->scissor.w  = -1;
+	self->scissor_test = -1;
+
+	self->blend.src = UNKNOWN;
+	self->blend.dst = UNKNOWN;
+
+	for (i = 0; i < RTB_RENDER_STATE_TEXTURE_UNITS; i++) {
+		self->textures[i].target  = UNKNOWN;
+		self->textures[i].texture = UNKNOWN;
+	}
+
+	/* we don't know what's been done to whatever program is bound. */
+	self->modelview_dirty = 1;
+}
+
+void
+rtb_render_state_begin_frame(struct rtb_render_state *self)
+{
+	rtb_render_state_invalidate(self);
+
+	self->stats.issued = 0;
+	self->stats.elided = 0;
+	self->stats.repainted_pixels = 0;
+	self->stats.repainted_elements = 0;
+}
+
+int
+rtb_render_state_use_program(struct rtb_render_state *self, GLuint program)
+{
+	ISSUE_UNLESS(self->program == program);
+
+	glUseProgram(program);
+	self->program = program;
+	return 1;
+}
+
+int
+rtb_render_state_bind_frame_uniforms(struct rtb_render_state *self,
+		GLuint buffer)
+{
+	ISSUE_UNLESS(self->frame_uniforms == buffer);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, RTB_SHADER_FRAME_UNIFORMS, buffer);
+	self->frame_uniforms = buffer;
+	return 1;
+}
+
+int
+rtb_render_state_bind_framebuffer(struct rtb_render_state *self,
+		GLuint framebuffer)
+{
+	ISSUE_UNLESS(self->framebuffer == framebuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	self->framebuffer = framebuffer;
+	return 1;
+}
+
+GLuint
+rtb_render_state_get_framebuffer(struct rtb_render_state *self)
+{
+	GLint bound;
+
+	/* only go to the driver if we really have to. */
+	if (self->framebuffer == UNKNOWN) {
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound);
+		self->framebuffer = bound;
+	}
+
+	return self->framebuffer;
+}
+
+int
+rtb_render_state_viewport(struct rtb_render_state *self,
+		GLint x, GLint y, GLsizei w, GLsizei h)
+{
+	ISSUE_UNLESS(self->viewport.x == x && self->viewport.y == y
+			&& self->viewport.w == w && self->viewport.h == h);
+
+	glViewport(x, y, w, h);
+
+	self->viewport.x = x;
+	self->viewport.y = y;
+	self->viewport.w = w;
+	self->viewport.h = h;
+	return 1;
+}
+
+void
+rtb_render_state_get_viewport(struct rtb_render_state *self,
+		GLint out[4])
+{
+	if (self->viewport.w < 0) {
+		glGetIntegerv(GL_VIEWPORT, out);
+
+		self->viewport.x = out[0];
+		self->viewport.y = out[1];
+		self->viewport.w = out[2];
+		self->viewport.h = out[3];
+		return;
+	}
+
+	out[0] = self->viewport.x;
+	out[1] = self->viewport.y;
+	out[2] = self->viewport.w;
+	out[3] = self->viewport.h;
+}
+
+int
+rtb_render_state_scissor(struct rtb_render_state *self,
+		GLint x, GLint y, GLsizei w, GLsizei h)
+{
+	ISSUE_UNLESS(self->scissor.x == x && self->scissor.y == y
+			&& self->scissor.w == w && self->scissor.h == h);
+
+	glScissor(x, y, w, h);
+
+	self->scissor.x = x;
+	self->scissor.y = y;
+	self->scissor.w = w;
+	self->scissor.h = h;
+	return 1;
+}
+
+int
+rtb_render_state_scissor_test(struct rtb_render_state *self, int enable)
+{
+	enable = !!enable;
+	ISSUE_UNLESS(self->scissor_test == enable);
+
+	if (enable)
+		glEnable(GL_SCISSOR_TEST);
+	else
+		glDisable(GL_SCISSOR_TEST);
+
+	self->scissor_test = enable;
+	return 1;
+}
+
+int
+rtb_render_state_blend_func(struct rtb_render_state *self,
+		GLenum src, GLenum dst)
+{
+	ISSUE_UNLESS(self->blend.src == src && self->blend.dst == dst);
+
+	glBlendFunc(src, dst);
+
+	self->blend.src = src;
+	self->blend.dst = dst;
+	return 1;
+}
+
+int
+rtb_render_state_bind_texture(struct rtb_render_state *self,
+		GLuint unit, GLenum target, GLuint texture)
+{
+	ISSUE_UNLESS(self->textures[unit].target == target
+			&& self->textures[unit].texture == texture);
+
+	/* everybody outside of here assumes that unit 0 is active, so we
+	 * always put it back. */
+	if (unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		glActiveTexture(GL_TEXTURE0);
+	} else
+		glBindTexture(target, texture);
+
+	self->textures[unit].target  = target;
+	self->textures[unit].texture = texture;
+	return 1;
+}
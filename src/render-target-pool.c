@@ -0,0 +1,219 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/render-target-pool.h>
+
+#define BYTES_PER_PIXEL 4
+
+/**
+ * size classes
+ */
+
+static int
+size_class(int size)
+{
+	int class = RTB_RENDER_TARGET_MIN_SIZE;
+
+	/* alternating between powers of two and halfway between them keeps
+	 * the waste under 50% in each dimension. */
+	for (;;) {
+		if (size <= class)
+			return class;
+
+		if (size <= class + class / 2)
+			return class + class / 2;
+
+		class *= 2;
+	}
+}
+
+static size_t
+target_bytes(const struct rtb_render_target *self)
+{
+	return (size_t) self->w * self->h * BYTES_PER_PIXEL;
+}
+
+/**
+ * targets
+ */
+
+static struct rtb_render_target *
+target_new(struct rtb_render_target_pool *pool, int w, int h)
+{
+	struct rtb_render_target *self;
+
+	self = calloc(1, sizeof(*self));
+	if (!self)
+		goto err_alloc;
+
+	glGenTextures(1, &self->texture);
+	if (!self->texture)
+		goto err_texture;
+
+	glGenFramebuffers(1, &self->fbo);
+	if (!self->fbo)
+		goto err_fbo;
+
+	self->w = w;
+	self->h = h;
+	self->pool = pool;
+
+	glBindTexture(GL_TEXTURE_2D, self->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			GL_TEXTURE_2D, self->texture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	pool->bytes += target_bytes(self);
+	return self;
+
+err_fbo:
+	glDeleteTextures(1, &self->texture);
+err_texture:
+	free(self);
+err_alloc:
+	return NULL;
+}
+
+static void
+target_free(struct rtb_render_target *self)
+{
+	if (self->pool)
+		self->pool->bytes -= target_bytes(self);
+
+	glDeleteFramebuffers(1, &self->fbo);
+	glDeleteTextures(1, &self->texture);
+	free(self);
+}
+
+static void
+evict(struct rtb_render_target_pool *self)
+{
+	struct rtb_render_target *lru;
+
+	while (self->bytes > self->budget
+			&& (lru = TAILQ_LAST(&self->idle, rtb_render_targets))) {
+		TAILQ_REMOVE(&self->idle, lru, entry);
+		target_free(lru);
+	}
+}
+
+/**
+ * public API
+ */
+
+int
+rtb_render_target_fits(const struct rtb_render_target *self, int w, int h)
+{
+	int cw = size_class(w), ch = size_class(h);
+
+	/* big enough, but not hogging something far bigger than we need. */
+	return self->w >= cw && self->h >= ch
+		&& self->w <= cw * 2 && self->h <= ch * 2;
+}
+
+struct rtb_render_target *
+rtb_render_target_acquire(struct rtb_render_target_pool *self, int w, int h)
+{
+	struct rtb_render_target *iter, *best = NULL;
+
+	TAILQ_FOREACH(iter, &self->idle, entry) {
+		if (!rtb_render_target_fits(iter, w, h))
+			continue;
+
+		if (!best || (iter->w * iter->h) < (best->w * best->h))
+			best = iter;
+	}
+
+	if (best)
+		TAILQ_REMOVE(&self->idle, best, entry);
+	else {
+		best = target_new(self, size_class(w), size_class(h));
+		if (!best)
+			return NULL;
+	}
+
+	TAILQ_INSERT_TAIL(&self->live, best, entry);
+	evict(self);
+
+	return best;
+}
+
+void
+rtb_render_target_release(struct rtb_render_target *self)
+{
+	struct rtb_render_target_pool *pool = self->pool;
+
+	if (!pool) {
+		target_free(self);
+		return;
+	}
+
+	TAILQ_REMOVE(&pool->live, self, entry);
+	TAILQ_INSERT_HEAD(&pool->idle, self, entry);
+	evict(pool);
+}
+
+int
+rtb_render_target_pool_init(struct rtb_render_target_pool *self)
+{
+	TAILQ_INIT(&self->idle);
+	TAILQ_INIT(&self->live);
+
+	self->bytes = 0;
+	self->budget = RTB_RENDER_TARGET_POOL_BUDGET;
+
+	return 0;
+}
+
+void
+rtb_render_target_pool_fini(struct rtb_render_target_pool *self)
+{
+	struct rtb_render_target *iter;
+
+	while ((iter = TAILQ_FIRST(&self->idle))) {
+		TAILQ_REMOVE(&self->idle, iter, entry);
+		target_free(iter);
+	}
+
+	/* anything still in use is freed when it's released. */
+	while ((iter = TAILQ_FIRST(&self->live))) {
+		TAILQ_REMOVE(&self->live, iter, entry);
+		iter->pool = NULL;
+	}
+
+	self->bytes = 0;
+}
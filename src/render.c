@@ -27,8 +27,10 @@
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/window.h>
 #include <rutabaga/render.h>
+#include <rutabaga/display-list.h>
 #include <rutabaga/style.h>
 #include <rutabaga/quad.h>
+#include <rutabaga/stylequad-batch.h>
 
 #include "rtb_private/util.h"
 
@@ -43,8 +45,8 @@ rtb_render_use_style_fg(struct rtb_render_context *ctx,
 		struct rtb_element *from)
 {
 	const struct rtb_style_property_definition *prop;
-	prop = rtb_style_query_prop(from,
-			"background-color", RTB_STYLE_PROP_COLOR, 1);
+	prop = rtb_style_query_prop_id(from,
+			RTB_STYLE_PROP_ID_BACKGROUND_COLOR, RTB_STYLE_PROP_COLOR, 1);
 
 	rtb_render_set_color(ctx,
 			prop->color.r,
@@ -58,8 +60,8 @@ rtb_render_use_style_bg(struct rtb_render_context *ctx,
 		struct rtb_element *from)
 {
 	const struct rtb_style_property_definition *prop;
-	prop = rtb_style_query_prop(from,
-			"color", RTB_STYLE_PROP_COLOR, 1);
+	prop = rtb_style_query_prop_id(from,
+			RTB_STYLE_PROP_ID_COLOR, RTB_STYLE_PROP_COLOR, 1);
 
 	rtb_render_set_color(ctx,
 			prop->color.r,
@@ -97,6 +99,8 @@ rtb_render_set_modelview(struct rtb_render_context *ctx, const GLfloat *matrix)
 {
 	glUniformMatrix4fv(ctx->shader->matrices.modelview,
 		1, GL_FALSE, matrix);
+
+	ctx->window->local_storage.state.modelview_dirty = 1;
 }
 
 /**
@@ -107,32 +111,12 @@ static void
 render_quad(struct rtb_render_context *ctx, struct rtb_quad *quad,
 		GLenum mode, GLuint ibo)
 {
-	const struct rtb_shader *shader = ctx->shader;
-
 	if (!quad->vertices)
 		return;
 
-	glBindBuffer(GL_ARRAY_BUFFER, quad->vertices);
-	glEnableVertexAttribArray(shader->vertex);
-	glVertexAttribPointer(shader->vertex, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-	if (quad->tex_coords) {
-		glBindBuffer(GL_ARRAY_BUFFER, quad->tex_coords);
-		glEnableVertexAttribArray(shader->tex_coord);
-		glVertexAttribPointer(shader->tex_coord,
-				2, GL_FLOAT, GL_FALSE, 0, 0);
-	}
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
+	glBindVertexArray(quad->vao);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	glDrawElements(mode, 4, GL_UNSIGNED_BYTE, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-	glDisableVertexAttribArray(shader->vertex);
-
-	if (quad->tex_coords)
-		glDisableVertexAttribArray(shader->tex_coord);
 }
 
 void
@@ -149,13 +133,6 @@ rtb_render_quad(struct rtb_render_context *ctx, struct rtb_quad *quad)
 			ctx->window->local_storage.ibo.quad.solid);
 }
 
-void
-rtb_render_clear(struct rtb_element *elem)
-{
-	glClearColor(0.f, 0.f, 0.f, 0.f);
-	glClear(GL_COLOR_BUFFER_BIT);
-}
-
 /**
  * state changes
  */
@@ -167,45 +144,126 @@ static const GLfloat identity_matrix[] = {
 	0.f, 0.f, 0.f, 1.f
 };
 
+static void
+apply_element_state(struct rtb_render_context *ctx)
+{
+	struct rtb_render_state *state = &ctx->window->local_storage.state;
+	struct rtb_element *elem = ctx->element;
+	struct rtb_rect scissor;
+
+	if (!ctx->element_state_stale || !elem)
+		return;
+
+	scissor = elem->rect;
+	if (ctx->clip)
+		rtb_rect_intersect(&scissor, &elem->rect, ctx->clip);
+
+	rtb_render_state_scissor(state,
+			scissor.x - elem->surface->x,
+			elem->surface->y + elem->surface->h - scissor.y2,
+			scissor.w, scissor.h);
+
+	rtb_render_state_blend_func(state,
+			GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	ctx->element_state_stale = 0;
+}
+
+void
+rtb_render_flush(struct rtb_render_context *ctx)
+{
+	if (!ctx->batch || rtb_stylequad_batch_is_empty(ctx->batch))
+		return;
+
+	rtb_stylequad_batch_flush(ctx->batch, ctx);
+	ctx->element_state_stale = 1;
+}
+
+void
+rtb_render_clear(struct rtb_element *elem)
+{
+	struct rtb_render_context *ctx = rtb_render_get_context(elem);
+
+	rtb_render_flush(ctx);
+	apply_element_state(ctx);
+
+	glClearColor(ctx->clear_color[0], ctx->clear_color[1],
+			ctx->clear_color[2], ctx->clear_color[3]);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
 void
 rtb_render_use_shader(struct rtb_render_context *ctx,
 		const struct rtb_shader *shader)
 {
-	GLuint program;
-	program = shader->program;
+	struct rtb_render_state *state = &ctx->window->local_storage.state;
+	int changed;
+
+	/* anything queued was submitted before whatever's about to be
+	 * drawn with this shader, so it has to hit the framebuffer first. */
+	rtb_render_flush(ctx);
+
+	/* drawing outside of the batch, which a display list can't hold. */
+	if (ctx->recording)
+		rtb_display_list_make_opaque(ctx->recording);
+
 	ctx->shader = shader;
 
-	glUseProgram(program);
+	changed  = rtb_render_state_bind_frame_uniforms(state,
+			ctx->frame_uniforms);
+	changed |= rtb_render_state_use_program(state, shader->program);
+
+	/* the projection lives in the frame uniform block, but shaders that
+	 * still declare it as a plain uniform get it the old way. */
+	if (changed && shader->matrices.projection != (GLuint) -1)
+		glUniformMatrix4fv(shader->matrices.projection,
+			1, GL_FALSE, ctx->projection.data);
+
+	if (changed || state->modelview_dirty) {
+		glUniformMatrix4fv(shader->matrices.modelview,
+			1, GL_FALSE, identity_matrix);
+		state->modelview_dirty = 0;
+	}
 
-	glUniformMatrix4fv(shader->matrices.projection,
-		1, GL_FALSE, ctx->projection.data);
-	glUniformMatrix4fv(shader->matrices.modelview,
-		1, GL_FALSE, identity_matrix);
+	apply_element_state(ctx);
 }
 
 void
 rtb_render_reset(struct rtb_element *elem)
 {
 	struct rtb_render_context *ctx = rtb_render_get_context(elem);
-	rtb_render_use_shader(ctx, &elem->window->local_storage.shader.dfault);
 
-	glScissor(elem->x - elem->surface->x,
-			elem->surface->y + elem->surface->h - elem->h - elem->y,
-			elem->w, elem->h);
+	ctx->element = elem;
+	ctx->element_state_stale = 1;
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	rtb_render_use_shader(ctx, &elem->window->local_storage.shader.dfault);
 }
 
 void
 rtb_render_push(struct rtb_element *elem)
 {
-	rtb_render_reset(elem);
+	struct rtb_render_context *ctx = rtb_render_get_context(elem);
+
+	/* while batching, most elements only ever queue stylequads, so we
+	 * hold off on touching GL until something actually draws. */
+	if (ctx->batch) {
+		ctx->element = elem;
+		ctx->element_state_stale = 1;
+	} else
+		rtb_render_reset(elem);
 }
 
 void
 rtb_render_pop(struct rtb_element *elem)
 {
-	glUseProgram(0);
+	struct rtb_render_context *ctx = rtb_render_get_context(elem);
+
+	/* the program is left bound. the state tracker knows about it, so
+	 * whoever draws next only pays for a switch if they need one. */
+	ctx->element = (elem->parent
+			&& rtb_render_get_context(elem->parent) == ctx)
+		? elem->parent : NULL;
+	ctx->element_state_stale = 1;
 }
 
 struct rtb_render_context *
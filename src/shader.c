@@ -75,7 +75,7 @@ print_program_error(GLuint program)
 }
 
 static GLuint
-shader_link(struct rtb_shader *shader)
+shader_link(struct rtb_shader *shader, const struct rtb_shader_locations *loc)
 {
 	GLuint program;
 	GLint status;
@@ -88,6 +88,11 @@ shader_link(struct rtb_shader *shader)
 	if (shader->geometry_shader)
 		glAttachShader(program, shader->geometry_shader);
 
+	glBindAttribLocation(program, RTB_SHADER_ATTRIB_VERTEX,
+			loc->vertex ? loc->vertex : "vertex");
+	glBindAttribLocation(program, RTB_SHADER_ATTRIB_TEX_COORD,
+			loc->tex_coord ? loc->tex_coord : "tex_coord");
+
 	glLinkProgram(program);
 	glGetProgramiv(program, GL_LINK_STATUS, &status);
 
@@ -130,7 +135,7 @@ rtb_shader_create_with_locations(struct rtb_shader *shader,
 		const char *fragment_src,
 		const struct rtb_shader_locations *loc)
 {
-	GLuint program;
+	GLuint program, block;
 	int status;
 
 	shader->vertex_shader = glsl_compile(GL_VERTEX_SHADER, vertex_src);
@@ -145,7 +150,7 @@ rtb_shader_create_with_locations(struct rtb_shader *shader,
 			|| (geometry_src && !shader->geometry_shader))
 		return 0;
 
-	status = shader_link(shader);
+	status = shader_link(shader, loc);
 	if (!status)
 		return 0;
 
@@ -169,6 +174,10 @@ rtb_shader_create_with_locations(struct rtb_shader *shader,
 	CACHE_ATTRIBUTE(vertex);
 	CACHE_ATTRIBUTE(tex_coord);
 
+	block = glGetUniformBlockIndex(program, RTB_SHADER_FRAME_BLOCK);
+	if (block != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, block, RTB_SHADER_FRAME_UNIFORMS);
+
 	return status;
 }
 
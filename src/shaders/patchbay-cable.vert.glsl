@@ -0,0 +1,73 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#version 150
+
+/**
+ * every cable is a quad stretched between its two endpoints. the
+ * per-cable data lives in a buffer texture, two texels each:
+ *
+ *   0: from.x, from.y, to.x, to.y
+ *   1: color
+ */
+
+#define CABLE_TEXELS 2
+
+layout(std140) uniform rtb_frame {
+	mat4 projection;
+};
+
+uniform samplerBuffer cables;
+uniform float half_width;
+
+/* x is 0 at the start of the cable and 1 at the end, y is -1 on one side
+ * and 1 on the other. */
+in vec2 vertex;
+
+out float across;
+flat out vec4 color;
+
+void main()
+{
+	vec4 endpoints = texelFetch(cables, gl_InstanceID * CABLE_TEXELS);
+	vec2 from = endpoints.xy;
+	vec2 to = endpoints.zw;
+	vec2 along = to - from;
+	float len = length(along);
+	float extent;
+
+	color = texelFetch(cables, (gl_InstanceID * CABLE_TEXELS) + 1);
+
+	along = (len > 0.0) ? (along / len) : vec2(1.0, 0.0);
+
+	/* an extra pixel on each side for the edges to fade out over. */
+	extent = half_width + 1.0;
+	across = vertex.y * extent;
+
+	gl_Position = projection * vec4(
+			mix(from, to, vertex.x) + (vec2(-along.y, along.x) * across),
+			0.0, 1.0);
+}
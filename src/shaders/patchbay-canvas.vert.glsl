@@ -26,7 +26,9 @@
 
 #version 150
 
-uniform mat4 projection;
+layout(std140) uniform rtb_frame {
+	mat4 projection;
+};
 uniform mat4 modelview;
 
 uniform vec2 offset;
@@ -0,0 +1,102 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#version 150
+
+/**
+ * per-instance data lives in a buffer texture (GL 3.2 has no instanced
+ * vertex attributes). each instance is seven texels, see
+ * include/rutabaga/stylequad-batch.h:
+ *
+ *   0: center.x, center.y, half width, half height
+ *   1: color
+ *   2: modelview rotation (2x2, column-major)
+ *   3: clip rect (x, y, x2, y2)
+ *   4: border in pixels (left, top, right, bottom)
+ *   5: border normalised to the image (left, top, right, bottom)
+ *   6: where the image sits in the texture (u, v, width, height)
+ */
+
+#define INSTANCE_TEXELS 7
+
+layout(std140) uniform rtb_frame {
+	mat4 projection;
+};
+
+uniform samplerBuffer instances;
+uniform int instance_base;
+
+/* (column, row) in the 4x4 grid of 9-slice vertices */
+in vec2 vertex;
+
+out vec2 coord;
+out vec2 position;
+flat out vec4 color;
+flat out vec4 clip;
+
+vec4
+fetch(int field)
+{
+	return texelFetch(instances,
+			((instance_base + gl_InstanceID) * INSTANCE_TEXELS) + field);
+}
+
+void main()
+{
+	vec4 geometry   = fetch(0);
+	vec4 rotation   = fetch(2);
+	vec4 border     = fetch(4);
+	vec4 tex_border = fetch(5);
+	vec4 tex_rect   = fetch(6);
+
+	int col = int(vertex.x);
+	int row = int(vertex.y);
+
+	vec4 xs = vec4(
+			-geometry.z,
+			-geometry.z + border.x,
+			geometry.z - border.z,
+			geometry.z);
+
+	vec4 ys = vec4(
+			-geometry.w,
+			-geometry.w + border.y,
+			geometry.w - border.w,
+			geometry.w);
+
+	vec4 us = vec4(0.0, tex_border.x, 1.0 - tex_border.z, 1.0);
+	vec4 vs = vec4(1.0, 1.0 - tex_border.y, tex_border.w, 0.0);
+
+	mat2 rotate = mat2(rotation.xy, rotation.zw);
+
+	position = geometry.xy + (rotate * vec2(xs[col], ys[row]));
+	coord = tex_rect.xy + (vec2(us[col], vs[row]) * tex_rect.zw);
+
+	color = fetch(1);
+	clip  = fetch(3);
+
+	gl_Position = projection * vec4(position, 0.0, 1.0);
+}
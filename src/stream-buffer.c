@@ -0,0 +1,170 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/stream-buffer.h>
+
+#define SIZE         RTB_STREAM_BUFFER_SIZE
+#define SEGMENTS     RTB_STREAM_BUFFER_SEGMENTS
+#define SEGMENT_SIZE (SIZE / SEGMENTS)
+#define ALIGNMENT    RTB_STREAM_BUFFER_ALIGNMENT
+
+/**
+ * fencing
+ */
+
+static void
+drop_fence(struct rtb_stream_buffer *self, int segment)
+{
+	if (!self->fences[segment])
+		return;
+
+	glDeleteSync(self->fences[segment]);
+	self->fences[segment] = NULL;
+}
+
+static int
+segment_is_free(struct rtb_stream_buffer *self, int segment)
+{
+	GLenum status;
+
+	if (!self->fences[segment])
+		return 1;
+
+	status = glClientWaitSync(self->fences[segment], 0, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return 0;
+
+	drop_fence(self, segment);
+	return 1;
+}
+
+static void
+orphan(struct rtb_stream_buffer *self)
+{
+	int i;
+
+	/* the driver hands us fresh storage and keeps the old one around for
+	 * as long as pending draws need it. */
+	glBufferData(GL_ARRAY_BUFFER, SIZE, NULL, GL_STREAM_DRAW);
+
+	for (i = 0; i < SEGMENTS; i++)
+		drop_fence(self, i);
+
+	self->stats.orphans++;
+}
+
+static void
+enter_segment(struct rtb_stream_buffer *self, int segment)
+{
+	/* everything drawn out of the segment we're leaving has already
+	 * been submitted. */
+	drop_fence(self, self->segment);
+	self->fences[self->segment] =
+		glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	self->segment = segment;
+
+	if (!segment_is_free(self, segment))
+		orphan(self);
+}
+
+/**
+ * public API
+ */
+
+GLintptr
+rtb_stream_buffer_upload(struct rtb_stream_buffer *self,
+		const void *data, GLsizeiptr size)
+{
+	GLintptr offset;
+	void *dst;
+	int last;
+
+	if (size <= 0 || size > SIZE)
+		return -1;
+
+	glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+
+	offset = (self->head + (ALIGNMENT - 1)) & ~(GLintptr) (ALIGNMENT - 1);
+
+	if (offset + size > SIZE) {
+		offset = 0;
+		enter_segment(self, 0);
+	}
+
+	last = (offset + size - 1) / SEGMENT_SIZE;
+	while (self->segment < last)
+		enter_segment(self, self->segment + 1);
+
+	/* the fences are what keeps us off of anything still in use, so the
+	 * driver needn't bother synchronising. */
+	dst = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+			| GL_MAP_UNSYNCHRONIZED_BIT);
+
+	if (!dst)
+		return -1;
+
+	memcpy(dst, data, size);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	self->head = offset + size;
+
+	self->stats.uploads++;
+	self->stats.bytes += size;
+
+	return offset;
+}
+
+int
+rtb_stream_buffer_init(struct rtb_stream_buffer *self)
+{
+	memset(self, 0, sizeof(*self));
+
+	glGenBuffers(1, &self->vbo);
+	if (!self->vbo)
+		return -1;
+
+	glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
+	glBufferData(GL_ARRAY_BUFFER, SIZE, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return 0;
+}
+
+void
+rtb_stream_buffer_fini(struct rtb_stream_buffer *self)
+{
+	int i;
+
+	for (i = 0; i < SEGMENTS; i++)
+		drop_fence(self, i);
+
+	glDeleteBuffers(1, &self->vbo);
+}
@@ -30,6 +30,10 @@
 #include <rutabaga/style.h>
 #include <rutabaga/asset.h>
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "rtb_private/util.h"
 
 /* generated as part of the build process */
@@ -66,6 +70,145 @@ draw_state_for_elem_state(unsigned int state)
 	return RTB_DRAW_NORMAL;
 }
 
+/**
+ * property IDs
+ */
+
+static const struct {
+	const char *name;
+	rtb_style_prop_type_t type;
+} builtin_props[RTB_STYLE_PROP_ID_BUILTIN_COUNT] = {
+	[RTB_STYLE_PROP_ID_MIN_WIDTH] =
+		{"min-width", RTB_STYLE_PROP_FLOAT},
+	[RTB_STYLE_PROP_ID_MIN_HEIGHT] =
+		{"min-height", RTB_STYLE_PROP_FLOAT},
+	[RTB_STYLE_PROP_ID_COLOR] =
+		{"color", RTB_STYLE_PROP_COLOR},
+	[RTB_STYLE_PROP_ID_BACKGROUND_COLOR] =
+		{"background-color", RTB_STYLE_PROP_COLOR},
+	[RTB_STYLE_PROP_ID_BORDER_COLOR] =
+		{"border-color", RTB_STYLE_PROP_COLOR},
+	[RTB_STYLE_PROP_ID_BACKGROUND_IMAGE] =
+		{"background-image", RTB_STYLE_PROP_TEXTURE},
+	[RTB_STYLE_PROP_ID_BORDER_IMAGE] =
+		{"border-image", RTB_STYLE_PROP_TEXTURE}
+};
+
+/* FNV-1a over the name, with the type folded in at the end */
+static uint32_t
+prop_hash(const char *name, rtb_style_prop_type_t type)
+{
+	uint32_t h = 2166136261u;
+
+	for (; *name; name++) {
+		h ^= (uint8_t) *name;
+		h *= 16777619u;
+	}
+
+	h ^= (uint32_t) type;
+	h *= 16777619u;
+
+	return h;
+}
+
+static rtb_style_prop_id_t *
+prop_bucket(struct rtb_style_prop_table *tbl,
+		const char *name, rtb_style_prop_type_t type)
+{
+	size_t mask, i;
+	rtb_style_prop_id_t id;
+
+	mask = tbl->nbuckets - 1;
+
+	for (i = prop_hash(name, type) & mask;; i = (i + 1) & mask) {
+		id = tbl->buckets[i];
+
+		if (id == RTB_STYLE_PROP_ID_NONE
+				|| (tbl->keys[id].type == type
+					&& !strcmp(tbl->keys[id].name, name)))
+			return &tbl->buckets[i];
+	}
+}
+
+static rtb_style_prop_id_t
+prop_find(struct rtb_style_prop_table *tbl,
+		const char *name, rtb_style_prop_type_t type)
+{
+	if (!tbl->nbuckets)
+		return RTB_STYLE_PROP_ID_NONE;
+
+	return *prop_bucket(tbl, name, type);
+}
+
+static int
+prop_table_grow(struct rtb_style_prop_table *tbl)
+{
+	rtb_style_prop_id_t *buckets, *old_buckets;
+	size_t i, nbuckets, old_nbuckets;
+
+	nbuckets = tbl->nbuckets ? tbl->nbuckets * 2 : 64;
+	buckets = malloc(nbuckets * sizeof(*buckets));
+	if (!buckets)
+		return -1;
+
+	for (i = 0; i < nbuckets; i++)
+		buckets[i] = RTB_STYLE_PROP_ID_NONE;
+
+	old_buckets = tbl->buckets;
+	old_nbuckets = tbl->nbuckets;
+
+	tbl->buckets = buckets;
+	tbl->nbuckets = nbuckets;
+
+	for (i = 0; i < old_nbuckets; i++) {
+		if (old_buckets[i] == RTB_STYLE_PROP_ID_NONE)
+			continue;
+
+		*prop_bucket(tbl, tbl->keys[old_buckets[i]].name,
+				tbl->keys[old_buckets[i]].type) = old_buckets[i];
+	}
+
+	free(old_buckets);
+	return 0;
+}
+
+static rtb_style_prop_id_t
+prop_intern(struct rtb_style_prop_table *tbl,
+		const char *name, rtb_style_prop_type_t type)
+{
+	struct rtb_style_prop_key *keys;
+	rtb_style_prop_id_t *bucket, id;
+	size_t capacity;
+
+	if ((id = prop_find(tbl, name, type)) != RTB_STYLE_PROP_ID_NONE)
+		return id;
+
+	/* keep the load factor under a half */
+	if ((tbl->nkeys + 1) * 2 > tbl->nbuckets && prop_table_grow(tbl))
+		return RTB_STYLE_PROP_ID_NONE;
+
+	if (tbl->nkeys == tbl->keys_capacity) {
+		capacity = tbl->keys_capacity ? tbl->keys_capacity * 2 : 32;
+		keys = realloc(tbl->keys, capacity * sizeof(*keys));
+		if (!keys)
+			return RTB_STYLE_PROP_ID_NONE;
+
+		tbl->keys = keys;
+		tbl->keys_capacity = capacity;
+	}
+
+	if (!(tbl->keys[tbl->nkeys].name = strdup(name)))
+		return RTB_STYLE_PROP_ID_NONE;
+
+	tbl->keys[tbl->nkeys].type = type;
+
+	id = (rtb_style_prop_id_t) tbl->nkeys++;
+	bucket = prop_bucket(tbl, name, type);
+	*bucket = id;
+
+	return id;
+}
+
 /**
  * style initialization
  */
@@ -132,30 +275,44 @@ load_assets(struct rtb_window *window,
 	return assets_loaded;
 }
 
+/* bumped every time a style list is resolved, which invalidates what the
+ * type descriptors have cached in style_for_type(). */
+static unsigned int resolve_generation = 1;
+
 static struct rtb_style *
-style_for_type(struct rtb_type_atom *atom, struct rtb_style *s)
+style_for_type(struct rtb_type_atom *atom, struct rtb_style *style_list)
 {
-	for (; s->for_type; s++) {
-		if (s->resolved_type && rtb_is_type(s->resolved_type, atom)) {
-			return s;
-		}
+	struct rtb_type_atom_descriptor *type = atom->type;
+	struct rtb_style *s;
+
+	if (type && type->style_cache.list == style_list
+			&& type->style_cache.generation == resolve_generation)
+		return type->style_cache.style;
+
+	for (s = style_list; s->for_type; s++)
+		if (s->resolved_type && rtb_type_is_a(type, s->resolved_type))
+			break;
+
+	if (!s->for_type)
+		s = NULL;
+
+	if (type) {
+		type->style_cache.list = style_list;
+		type->style_cache.generation = resolve_generation;
+		type->style_cache.style = s;
 	}
 
-	return NULL;
+	return s;
 }
 
 static struct rtb_style *
 inherits_from(struct rtb_type_atom_descriptor *type,
 		struct rtb_style *style_list)
 {
-	struct rtb_type_atom_descriptor *super;
-
-	for (; style_list->for_type; style_list++) {
-		for (super = type->super[0]; super; super = super->super[0]) {
-			if (style_list->resolved_type == super)
-				return style_list;
-		}
-	}
+	for (; style_list->for_type; style_list++)
+		if (style_list->resolved_type && style_list->resolved_type != type
+				&& rtb_type_is_a(type, style_list->resolved_type))
+			return style_list;
 
 	return NULL;
 }
@@ -169,8 +326,6 @@ style_resolve(struct rtb_window *window, struct rtb_style *style)
 	if (!style->resolved_type)
 		return -1;
 
-	style->inherit_from = inherits_from(style->resolved_type, style);
-
 	for (state = 0; state < RTB_DRAW_STATE_COUNT; state++) {
 		if (load_assets(window, style->properties[state]) < 0)
 			printf("rutabaga: error loading assets for %s\n",
@@ -180,62 +335,152 @@ style_resolve(struct rtb_window *window, struct rtb_style *style)
 	return 0;
 }
 
-/**
- * queries
- */
-
-static const struct rtb_style_property_definition *
-query_no_fallback(struct rtb_style *style_list, rtb_elem_state_t elem_state,
-		const char *property_name, rtb_style_prop_type_t type)
+static void
+style_free_computed(struct rtb_style *style)
 {
-	const struct rtb_style_property_definition *prop;
-	rtb_draw_state_t draw_state;
+	free(style->computed_storage);
+	style->computed_storage = NULL;
 
-	draw_state = draw_state_for_elem_state(elem_state);
-
-	for (; style_list; style_list = style_list->inherit_from) {
-		prop = style_list->properties[draw_state];
-
-		for (; !!prop->property_name; prop++)
-			if (!strcmp(prop->property_name, property_name)
-					&& prop->type == type)
-				return prop;
-	}
-
-	return NULL;
+	memset(style->computed, 0, sizeof(style->computed));
+	style->nprops = 0;
 }
 
-static const struct rtb_style_property_definition *
-query(struct rtb_style *style_list, rtb_elem_state_t elem_state,
-		const char *property_name, rtb_style_prop_type_t type,
-		int return_fallback)
+/* the element states to look at, in order, for a property in `state` */
+static int
+state_fallbacks(rtb_elem_state_t state, rtb_elem_state_t *chain)
 {
-	const struct rtb_style_property_definition *prop;
+	int n = 0;
 
-	if ((prop = query_no_fallback(style_list,
-					elem_state, property_name, type)))
-		return prop;
+	chain[n++] = state;
 
-	switch (elem_state) {
+	switch (state) {
 	case RTB_STATE_FOCUS_HOVER:
 	case RTB_STATE_FOCUS_ACTIVE:
-		if ((prop = query_no_fallback(style_list,
-						RTB_STATE_FOCUS, property_name, type)))
-			return prop;
+		chain[n++] = RTB_STATE_FOCUS;
 
 		/* fall-through */
 
 	case RTB_STATE_FOCUS:
 	case RTB_STATE_HOVER:
 	case RTB_STATE_ACTIVE:
-		if ((prop = query_no_fallback(style_list,
-						RTB_STATE_NORMAL, property_name, type)))
-			return prop;
+		chain[n++] = RTB_STATE_NORMAL;
 
 	default:
 		break;
 	}
 
+	return n;
+}
+
+/* first flattens the inherit_from chain into one row per draw state
+ * (the nearest style wins, and within a property list the first
+ * definition wins, same as walking them would), then composes those into
+ * one row per element state along the state fallbacks. */
+static int
+style_compute(struct rtb_window *win, struct rtb_style *style)
+{
+	const struct rtb_style_property_definition *prop, **flat, **row;
+	rtb_elem_state_t state, chain[3];
+	rtb_draw_state_t draw_state;
+	struct rtb_style *iter;
+	rtb_style_prop_id_t id;
+	size_t nprops, i;
+	int j, n;
+
+	style_free_computed(style);
+
+	nprops = win->style_props.nkeys;
+
+	flat = calloc(RTB_DRAW_STATE_COUNT * nprops, sizeof(*flat));
+	if (!flat)
+		goto err_flat;
+
+	style->computed_storage = calloc(RTB_ELEM_STATE_COUNT * nprops,
+			sizeof(*style->computed_storage));
+	if (!style->computed_storage)
+		goto err_storage;
+
+	for (draw_state = 0; draw_state < RTB_DRAW_STATE_COUNT; draw_state++) {
+		row = &flat[draw_state * nprops];
+
+		for (iter = style; iter; iter = iter->inherit_from) {
+			for (prop = iter->properties[draw_state];
+					prop->property_name; prop++) {
+				id = prop_find(&win->style_props,
+						prop->property_name, prop->type);
+
+				if (id != RTB_STYLE_PROP_ID_NONE && !row[id])
+					row[id] = prop;
+			}
+		}
+	}
+
+	for (state = 0; state < RTB_ELEM_STATE_COUNT; state++) {
+		row = &style->computed_storage[state * nprops];
+		n = state_fallbacks(state, chain);
+
+		for (i = 0; i < nprops; i++) {
+			for (j = 0; j < n && !row[i]; j++) {
+				draw_state = draw_state_for_elem_state(chain[j]);
+				row[i] = flat[draw_state * nprops + i];
+			}
+		}
+
+		style->computed[state] = row;
+
+		/* share with an earlier state if they came out the same, so
+		 * that telling them apart is a pointer compare. */
+		for (j = 0; j < (int) state; j++) {
+			if (!memcmp(style->computed[j], row, nprops * sizeof(*row))) {
+				style->computed[state] = style->computed[j];
+				break;
+			}
+		}
+	}
+
+	style->nprops = nprops;
+
+	free(flat);
+	return 0;
+
+err_storage:
+	free(flat);
+err_flat:
+	return -1;
+}
+
+static int
+intern_style_props(struct rtb_window *win, struct rtb_style *style)
+{
+	const struct rtb_style_property_definition *prop;
+	rtb_draw_state_t state;
+
+	for (state = 0; state < RTB_DRAW_STATE_COUNT; state++)
+		for (prop = style->properties[state]; prop->property_name; prop++)
+			if (prop_intern(&win->style_props, prop->property_name,
+						prop->type) == RTB_STYLE_PROP_ID_NONE)
+				return -1;
+
+	return 0;
+}
+
+/**
+ * queries
+ */
+
+static const struct rtb_style_property_definition *
+query_id(struct rtb_style *style, rtb_elem_state_t elem_state,
+		rtb_style_prop_id_t id, rtb_style_prop_type_t type,
+		int return_fallback)
+{
+	const struct rtb_style_property_definition *prop;
+
+	/* IDs are never negative, so the cast turns RTB_STYLE_PROP_ID_NONE
+	 * into a miss. */
+	if (style && (size_t) id < style->nprops
+			&& (prop = style->computed[elem_state][id]))
+		return prop;
+
 	if (return_fallback)
 		return &fallbacks[type];
 	return NULL;
@@ -245,8 +490,21 @@ const struct rtb_style_property_definition *rtb_style_query_prop(
 		struct rtb_element *elem, const char *property_name,
 		rtb_style_prop_type_t type, int should_return_fallback)
 {
-	return query(elem->style, elem->state,
-			property_name, type, should_return_fallback);
+	rtb_style_prop_id_t id = RTB_STYLE_PROP_ID_NONE;
+
+	if (elem->window)
+		id = prop_find(&elem->window->style_props, property_name, type);
+
+	return query_id(elem->style, elem->state,
+			id, type, should_return_fallback);
+}
+
+const struct rtb_style_property_definition *rtb_style_query_prop_id(
+		struct rtb_element *elem, rtb_style_prop_id_t id,
+		rtb_style_prop_type_t type, int should_return_fallback)
+{
+	return query_id(elem->style, elem->state,
+			id, type, should_return_fallback);
 }
 
 const struct rtb_style_property_definition *rtb_style_query_prop_in_tree(
@@ -254,10 +512,18 @@ const struct rtb_style_property_definition *rtb_style_query_prop_in_tree(
 		rtb_style_prop_type_t type, int should_return_fallback)
 {
 	const struct rtb_style_property_definition *prop;
+	rtb_style_prop_id_t id = RTB_STYLE_PROP_ID_NONE;
+
+	if (leaf->window) {
+		id = prop_find(&leaf->window->style_props, property_name, type);
+
+		if (id != RTB_STYLE_PROP_ID_NONE)
+			leaf->window->style_props.keys[id].inherited = 1;
+	}
 
 	for (prop = NULL; !prop && leaf->parent != leaf; leaf = leaf->parent)
-		prop = query(leaf->style, leaf->state,
-				property_name, type, should_return_fallback);
+		prop = query_id(leaf->style, leaf->state,
+				id, type, should_return_fallback);
 
 	return prop;
 }
@@ -274,6 +540,38 @@ rtb_style_elem_has_properties_for_state(struct rtb_element *elem,
 	return 0;
 }
 
+int
+rtb_style_states_differ(struct rtb_style *style,
+		rtb_elem_state_t a, rtb_elem_state_t b)
+{
+	/* not computed, so we can't know */
+	if (!style->computed[a] || !style->computed[b])
+		return 1;
+
+	return style->computed[a] != style->computed[b];
+}
+
+int
+rtb_style_inherited_differ(struct rtb_window *win, struct rtb_style *style,
+		rtb_elem_state_t a, rtb_elem_state_t b)
+{
+	const struct rtb_style_prop_key *keys = win->style_props.keys;
+	size_t id;
+
+	if (!style->computed[a] || !style->computed[b])
+		return 1;
+
+	if (style->computed[a] == style->computed[b])
+		return 0;
+
+	for (id = 0; id < style->nprops; id++)
+		if (keys[id].inherited
+				&& style->computed[a][id] != style->computed[b][id])
+			return 1;
+
+	return 0;
+}
+
 /**
  * public API
  */
@@ -285,6 +583,7 @@ rtb_style_resolve_list(struct rtb_window *win, struct rtb_style *style_list)
 	struct rtb_style *s;
 
 	unresolved_styles = 0;
+	resolve_generation++;
 
 	for (i = 0; style_list[i].for_type; i++) {
 		s = &style_list[i];
@@ -301,7 +600,69 @@ rtb_style_resolve_list(struct rtb_window *win, struct rtb_style *style_list)
 		s->inherit_from = inherits_from(s->resolved_type, style_list);
 	}
 
+	/* all the names have to be interned before any style gets computed,
+	 * since the computed styles are sized by the number of IDs. */
+	for (i = 0; style_list[i].for_type; i++)
+		if (style_list[i].resolved_type
+				&& intern_style_props(win, &style_list[i]))
+			goto err_props;
+
+	for (i = 0; style_list[i].for_type; i++)
+		if (style_list[i].resolved_type
+				&& style_compute(win, &style_list[i]))
+			goto err_props;
+
 	return unresolved_styles;
+
+err_props:
+	rtb_style_unresolve_list(style_list);
+	return -1;
+}
+
+void
+rtb_style_unresolve_list(struct rtb_style *style_list)
+{
+	for (; style_list->for_type; style_list++)
+		style_free_computed(style_list);
+}
+
+rtb_style_prop_id_t
+rtb_style_prop_id(struct rtb_window *win,
+		const char *property_name, rtb_style_prop_type_t type)
+{
+	return prop_intern(&win->style_props, property_name, type);
+}
+
+int
+rtb_style_prop_table_init(struct rtb_style_prop_table *tbl)
+{
+	int i;
+
+	memset(tbl, 0, sizeof(*tbl));
+
+	for (i = 0; i < RTB_STYLE_PROP_ID_BUILTIN_COUNT; i++)
+		if (prop_intern(tbl, builtin_props[i].name,
+					builtin_props[i].type) != i)
+			goto err;
+
+	return 0;
+
+err:
+	rtb_style_prop_table_fini(tbl);
+	return -1;
+}
+
+void
+rtb_style_prop_table_fini(struct rtb_style_prop_table *tbl)
+{
+	size_t i;
+
+	for (i = 0; i < tbl->nkeys; i++)
+		free(tbl->keys[i].name);
+
+	free(tbl->keys);
+	free(tbl->buckets);
+	memset(tbl, 0, sizeof(*tbl));
 }
 
 void
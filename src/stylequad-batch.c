@@ -0,0 +1,495 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/render.h>
+#include <rutabaga/style.h>
+#include <rutabaga/stylequad.h>
+#include <rutabaga/stylequad-batch.h>
+#include <rutabaga/display-list.h>
+#include <rutabaga/window.h>
+
+#include "rtb_private/stdlib-allocator.h"
+#include "rtb_private/util.h"
+
+#include "wwrl/vector.h"
+
+/**
+ * the batch shader builds the 9-slice geometry itself, so the only vertex
+ * data is which (column, row) of the slice grid each of the 16 stylequad
+ * vertices sits on. this lines up with the stylequad index buffers.
+ */
+
+static const GLfloat corner_vertices[16][2] = {
+	{0.f, 0.f}, {1.f, 0.f}, {1.f, 1.f}, {0.f, 1.f},
+	{2.f, 0.f}, {3.f, 0.f}, {3.f, 1.f}, {2.f, 1.f},
+	{0.f, 2.f}, {1.f, 2.f}, {1.f, 3.f}, {0.f, 3.f},
+	{2.f, 2.f}, {3.f, 2.f}, {3.f, 3.f}, {2.f, 3.f}
+};
+
+/**
+ * queueing
+ */
+
+#define SET4(dst, a, b, c, d) do {											\
+	(dst)[0] = (a);															\
+	(dst)[1] = (b);															\
+	(dst)[2] = (c);															\
+	(dst)[3] = (d);															\
+} while (0)
+
+static int
+rects_overlap(const struct rtb_rect *a, const struct rtb_rect *b)
+{
+	return a->x < b->x2 && b->x < a->x2
+		&& a->y < b->y2 && b->y < a->y2;
+}
+
+static struct rtb_stylequad_batch_run *
+find_run(struct rtb_stylequad_batch *self, rtb_stylequad_batch_kind_t kind,
+		GLuint texture, const struct rtb_rect *bounds)
+{
+	struct rtb_stylequad_batch_run *run;
+	size_t i, stop;
+
+	stop = (self->runs.size > RTB_STYLEQUAD_BATCH_LOOKBACK)
+		? self->runs.size - RTB_STYLEQUAD_BATCH_LOOKBACK : 0;
+
+	/* we can hoist an instance back into an earlier run as long as
+	 * nothing drawn in between overlaps it, so walk backwards until we
+	 * either find a run with the same state or hit something that we'd
+	 * end up drawing underneath. */
+	for (i = self->runs.size; i > stop; i--) {
+		run = &self->runs.data[i - 1];
+
+		if (run->kind == kind && run->texture == texture)
+			return run;
+
+		if (rects_overlap(&run->bounds, bounds))
+			return NULL;
+	}
+
+	return NULL;
+}
+
+void
+rtb_stylequad_batch_push(struct rtb_stylequad_batch *self,
+		struct rtb_render_context *ctx,
+		const struct rtb_stylequad_instance *instance,
+		const struct rtb_rect *bounds, rtb_stylequad_batch_kind_t kind,
+		GLuint texture, const struct rtb_size *texture_size)
+{
+	struct rtb_stylequad_batch_entry entry;
+	struct rtb_stylequad_batch_run *run;
+	struct rtb_rect clipped;
+
+	entry.instance = *instance;
+
+	/* repainting a damaged region, so the scissor would have been
+	 * narrowed to it. */
+	if (ctx->clip) {
+		if (!rtb_rect_intersect(&clipped, bounds, ctx->clip))
+			return;
+
+		bounds = &clipped;
+		SET4(entry.instance.clip,
+				bounds->x, bounds->y, bounds->x2, bounds->y2);
+	}
+
+	if (self->entries.size >= RTB_STYLEQUAD_BATCH_MAX_INSTANCES)
+		rtb_render_flush(ctx);
+
+	run = find_run(self, kind, texture, bounds);
+
+	if (!run) {
+		struct rtb_stylequad_batch_run new_run = {
+			.kind    = kind,
+			.texture = texture,
+			.bounds  = *bounds
+		};
+
+		if (texture)
+			new_run.texture_size = *texture_size;
+
+		VECTOR_PUSH_BACK(&self->runs, &new_run);
+		run = VECTOR_BACK(&self->runs);
+	} else {
+		run->bounds.x  = MIN(run->bounds.x,  bounds->x);
+		run->bounds.y  = MIN(run->bounds.y,  bounds->y);
+		run->bounds.x2 = MAX(run->bounds.x2, bounds->x2);
+		run->bounds.y2 = MAX(run->bounds.y2, bounds->y2);
+	}
+
+	run->count++;
+
+	entry.run = run - self->runs.data;
+	VECTOR_PUSH_BACK(&self->entries, &entry);
+}
+
+/* queues the instance, and keeps a copy in the display list of whichever
+ * element is being drawn. */
+static void
+emit(struct rtb_stylequad_batch *self, struct rtb_render_context *ctx,
+		const struct rtb_stylequad_instance *instance,
+		const struct rtb_rect *bounds, rtb_stylequad_batch_kind_t kind,
+		const struct rtb_stylequad_texture *tx)
+{
+	GLuint texture = tx ? tx->cached->gl_handle : 0;
+	const struct rtb_size *texture_size = tx ? &tx->definition->size : NULL;
+
+	if (ctx->recording)
+		rtb_display_list_record_quad(ctx->recording,
+				instance, bounds, kind, texture, texture_size);
+
+	rtb_stylequad_batch_push(self, ctx, instance, bounds, kind,
+			texture, texture_size);
+}
+
+static void
+set_tex_rect(struct rtb_stylequad_instance *instance,
+		const struct rtb_stylequad_texture *tx)
+{
+	const struct rtb_rect *uv = &tx->cached->uv;
+	SET4(instance->tex_rect, uv->x, uv->y, uv->w, uv->h);
+}
+
+void
+rtb_stylequad_batch_add(struct rtb_stylequad_batch *self,
+		struct rtb_render_context *ctx, const struct rtb_stylequad *quad,
+		const struct rtb_element *clip_to, const mat4 *modelview,
+		rtb_stylequad_draw_mode_t mode)
+{
+	const struct rtb_style_texture_definition *border_image =
+		quad->border_image.definition;
+	const struct rtb_style_texture_definition *background_image =
+		quad->background_image.definition;
+	const struct rtb_rect *bounds = &clip_to->rect;
+	const struct rtb_rgb_color *color;
+	struct rtb_stylequad_instance instance;
+
+	SET4(instance.geometry, quad->offset.x, quad->offset.y,
+			quad->size.w / 2.f, quad->size.h / 2.f);
+	SET4(instance.color, 0.f, 0.f, 0.f, 0.f);
+	SET4(instance.clip, bounds->x, bounds->y, bounds->x2, bounds->y2);
+	SET4(instance.tex_border, 0.f, 0.f, 0.f, 0.f);
+	SET4(instance.tex_rect, 0.f, 0.f, 1.f, 1.f);
+
+	if (modelview) {
+		SET4(instance.rotation,
+				modelview->data[0], modelview->data[1],
+				modelview->data[4], modelview->data[5]);
+
+		instance.geometry[0] += modelview->data[12];
+		instance.geometry[1] += modelview->data[13];
+	} else
+		SET4(instance.rotation, 1.f, 0.f, 0.f, 1.f);
+
+	/* the geometry is sliced by the border image whether or not we're
+	 * drawing it, same as rtb_stylequad_update_geometry(). */
+	if (border_image)
+		SET4(instance.border,
+				border_image->border.left,  border_image->border.top,
+				border_image->border.right, border_image->border.bottom);
+	else
+		SET4(instance.border, 0.f, 0.f, 0.f, 0.f);
+
+	if ((color = quad->properties.bg_color)
+			&& (mode & RTB_STYLEQUAD_DRAW_BG_COLOR)) {
+		SET4(instance.color, color->r, color->g, color->b, color->a);
+		emit(self, ctx, &instance, bounds,
+				RTB_STYLEQUAD_BATCH_SOLID, NULL);
+	}
+
+	if (background_image && (mode & RTB_STYLEQUAD_DRAW_BG_IMAGE)) {
+		set_tex_rect(&instance, &quad->background_image);
+		emit(self, ctx, &instance, bounds,
+				RTB_STYLEQUAD_BATCH_SOLID, &quad->background_image);
+	}
+
+	if (border_image && (mode & RTB_STYLEQUAD_DRAW_BORDER_IMAGE)) {
+		SET4(instance.tex_border,
+				border_image->border.left   / border_image->w,
+				border_image->border.top    / border_image->h,
+				border_image->border.right  / border_image->w,
+				border_image->border.bottom / border_image->h);
+		set_tex_rect(&instance, &quad->border_image);
+
+		emit(self, ctx, &instance, bounds,
+				RTB_STYLEQUAD_BATCH_BORDER, &quad->border_image);
+
+		if (border_image->flags & RTB_TEXTURE_FILL)
+			emit(self, ctx, &instance, bounds,
+					RTB_STYLEQUAD_BATCH_SOLID, &quad->border_image);
+	}
+
+	if ((color = quad->properties.border_color)
+			&& (mode & RTB_STYLEQUAD_DRAW_BORDER_COLOR)) {
+		SET4(instance.color, color->r, color->g, color->b, color->a);
+		emit(self, ctx, &instance, bounds,
+				RTB_STYLEQUAD_BATCH_OUTLINE, NULL);
+	}
+}
+
+/**
+ * drawing
+ */
+
+static int
+reserve_upload(struct rtb_stylequad_batch *self, size_t count)
+{
+	struct rtb_stylequad_instance *upload;
+
+	if (self->upload_capacity >= count)
+		return 0;
+
+	upload = realloc(self->upload, count * sizeof(*upload));
+	if (!upload)
+		return -1;
+
+	self->upload = upload;
+	self->upload_capacity = count;
+	return 0;
+}
+
+static void
+cache_locations(struct rtb_stylequad_batch *self,
+		const struct rtb_shader *shader)
+{
+	self->shader = shader;
+
+	self->loc.instances =
+		glGetUniformLocation(shader->program, "instances");
+	self->loc.instance_base =
+		glGetUniformLocation(shader->program, "instance_base");
+	self->loc.sampler =
+		glGetUniformLocation(shader->program, "tx_sampler");
+}
+
+void
+rtb_stylequad_batch_flush(struct rtb_stylequad_batch *self,
+		struct rtb_render_context *ctx)
+{
+	struct rtb_window_local_storage *local = &ctx->window->local_storage;
+	const struct rtb_shader *shader = &local->shader.stylequad_batch;
+	struct rtb_render_state *state = &local->state;
+	struct rtb_stylequad_batch_entry *entry;
+	struct rtb_stylequad_batch_run *run;
+	GLuint bound_texture;
+	size_t i, first;
+
+	if (rtb_stylequad_batch_is_empty(self))
+		return;
+
+	if (reserve_upload(self, self->entries.size))
+		goto out;
+
+	/* lay the instances out so that each run is contiguous, keeping
+	 * submission order within a run. */
+	for (first = 0, i = 0; i < self->runs.size; i++) {
+		run = &self->runs.data[i];
+		run->first = first;
+		first += run->count;
+		run->count = 0;
+	}
+
+	for (i = 0; i < self->entries.size; i++) {
+		entry = &self->entries.data[i];
+		run = &self->runs.data[entry->run];
+		self->upload[run->first + run->count++] = entry->instance;
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, self->instance_buffer);
+	glBufferData(GL_TEXTURE_BUFFER,
+			self->entries.size * sizeof(*self->upload), self->upload,
+			GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	rtb_render_state_bind_frame_uniforms(state, ctx->frame_uniforms);
+	rtb_render_state_use_program(state, shader->program);
+
+	if (self->shader != shader)
+		cache_locations(self, shader);
+
+	glUniform1i(self->loc.instances, 1);
+	glUniform1i(self->loc.sampler, 0);
+
+	rtb_render_state_bind_texture(state,
+			1, GL_TEXTURE_BUFFER, self->instance_texture);
+
+	/* clipping is done per-instance in the fragment shader. */
+	rtb_render_state_scissor_test(state, 0);
+	rtb_render_state_blend_func(state,
+			GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glLineWidth(1.f);
+
+	glBindVertexArray(self->corners_vao);
+
+	glUniform2f(shader->texture_size, 0.f, 0.f);
+	bound_texture = 0;
+
+	for (i = 0; i < self->runs.size; i++) {
+		GLenum mode;
+		GLuint ibo;
+		GLsizei count;
+
+		run = &self->runs.data[i];
+
+		if (run->texture != bound_texture) {
+			rtb_render_state_bind_texture(state,
+					0, GL_TEXTURE_2D, run->texture);
+
+			if (run->texture)
+				glUniform2f(shader->texture_size,
+						run->texture_size.w, run->texture_size.h);
+			else
+				glUniform2f(shader->texture_size, 0.f, 0.f);
+
+			bound_texture = run->texture;
+		}
+
+		/* XXX: hardcoded `count` values here, same as stylequad.c */
+		switch (run->kind) {
+		case RTB_STYLEQUAD_BATCH_BORDER:
+			mode  = GL_TRIANGLES;
+			ibo   = local->ibo.stylequad.border;
+			count = 48;
+			break;
+
+		case RTB_STYLEQUAD_BATCH_OUTLINE:
+			mode  = GL_LINE_LOOP;
+			ibo   = local->ibo.stylequad.outline;
+			count = 4;
+			break;
+
+		case RTB_STYLEQUAD_BATCH_SOLID:
+		default:
+			mode  = GL_TRIANGLE_STRIP;
+			ibo   = local->ibo.stylequad.solid;
+			count = 4;
+			break;
+		}
+
+		glUniform1i(self->loc.instance_base, run->first);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+		glDrawElementsInstanced(mode, count, GL_UNSIGNED_BYTE, 0,
+				run->count);
+
+		self->stats.draw_calls++;
+	}
+
+	rtb_render_state_scissor_test(state, 1);
+
+	self->stats.instances += self->entries.size;
+
+	/* whoever was drawing before the flush expects their program to
+	 * still be bound. */
+	if (ctx->shader)
+		rtb_render_state_use_program(state, ctx->shader->program);
+
+out:
+	VECTOR_CLEAR(&self->entries);
+	VECTOR_CLEAR(&self->runs);
+}
+
+/**
+ * lifecycle
+ */
+
+int
+rtb_stylequad_batch_init(struct rtb_stylequad_batch *self)
+{
+	memset(self, 0, sizeof(*self));
+
+	glGenBuffers(1, &self->corners);
+	if (!self->corners)
+		goto err_corners;
+
+	glGenVertexArrays(1, &self->corners_vao);
+	if (!self->corners_vao)
+		goto err_corners_vao;
+
+	glBindVertexArray(self->corners_vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, self->corners);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corner_vertices), corner_vertices,
+			GL_STATIC_DRAW);
+	glEnableVertexAttribArray(RTB_SHADER_ATTRIB_VERTEX);
+	glVertexAttribPointer(RTB_SHADER_ATTRIB_VERTEX,
+			2, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(0);
+
+	glGenBuffers(1, &self->instance_buffer);
+	if (!self->instance_buffer)
+		goto err_instance_buffer;
+
+	glGenTextures(1, &self->instance_texture);
+	if (!self->instance_texture)
+		goto err_instance_texture;
+
+	/* a buffer texture's storage has to exist before it's attached. */
+	glBindBuffer(GL_TEXTURE_BUFFER, self->instance_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(struct rtb_stylequad_instance),
+			NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_BUFFER, self->instance_texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, self->instance_buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	VECTOR_INIT(&self->entries, &stdlib_allocator, 64);
+	VECTOR_INIT(&self->runs, &stdlib_allocator, 16);
+
+	return 0;
+
+err_instance_texture:
+	glDeleteBuffers(1, &self->instance_buffer);
+err_instance_buffer:
+	glDeleteVertexArrays(1, &self->corners_vao);
+err_corners_vao:
+	glDeleteBuffers(1, &self->corners);
+err_corners:
+	return -1;
+}
+
+void
+rtb_stylequad_batch_fini(struct rtb_stylequad_batch *self)
+{
+	VECTOR_FREE(&self->runs);
+	VECTOR_FREE(&self->entries);
+	free(self->upload);
+
+	glDeleteTextures(1, &self->instance_texture);
+	glDeleteBuffers(1, &self->instance_buffer);
+	glDeleteVertexArrays(1, &self->corners_vao);
+	glDeleteBuffers(1, &self->corners);
+}
@@ -30,6 +30,7 @@
 #include <rutabaga/style.h>
 #include <rutabaga/quad.h>
 #include <rutabaga/stylequad.h>
+#include <rutabaga/stylequad-batch.h>
 #include <rutabaga/window.h>
 
 #include "rtb_private/util.h"
@@ -39,19 +40,11 @@
  */
 
 static void
-draw_solid(const struct rtb_stylequad *self, const struct rtb_shader *shader,
-		GLenum mode, GLuint ibo, GLsizei count)
+draw_vertex_array(GLuint vao, GLenum mode, GLuint ibo, GLsizei count)
 {
-	glBindBuffer(GL_ARRAY_BUFFER, self->vertices);
-	glEnableVertexAttribArray(shader->vertex);
-	glVertexAttribPointer(shader->vertex, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
+	glBindVertexArray(vao);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	glDrawElements(mode, count, GL_UNSIGNED_BYTE, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-	glDisableVertexAttribArray(shader->vertex);
 }
 
 static void
@@ -61,28 +54,21 @@ draw_textured(struct rtb_render_context *ctx,
 {
 	const struct rtb_shader *shader = ctx->shader;
 
-	glBindTexture(GL_TEXTURE_2D, tx->gl_handle);
+	rtb_render_state_bind_texture(&ctx->window->local_storage.state,
+			0, GL_TEXTURE_2D, tx->cached->gl_handle);
 	glUniform1i(shader->texture, 0);
 	glUniform2f(shader->texture_size,
 			tx->definition->w, tx->definition->h);
 
-	glBindBuffer(GL_ARRAY_BUFFER, tx->coords);
-	glEnableVertexAttribArray(shader->tex_coord);
-	glVertexAttribPointer(shader->tex_coord,
-			2, GL_FLOAT, GL_FALSE, 0, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
 	/* XXX: hardcoded `count` value here */
 	if (border)
-		draw_solid(self, shader, GL_TRIANGLES,
+		draw_vertex_array(tx->vao, GL_TRIANGLES,
 				ctx->window->local_storage.ibo.stylequad.border, 48);
 
 	if (!border || tx->definition->flags & RTB_TEXTURE_FILL)
-		draw_solid(self, shader, GL_TRIANGLE_STRIP,
+		draw_vertex_array(tx->vao, GL_TRIANGLE_STRIP,
 				ctx->window->local_storage.ibo.stylequad.solid, 4);
 
-	glDisableVertexAttribArray(shader->tex_coord);
-	glBindTexture(GL_TEXTURE_2D, 0);
 	glUniform2f(shader->texture_size, 0.f, 0.f);
 }
 
@@ -102,7 +88,7 @@ draw(struct rtb_render_context *ctx, const struct rtb_stylequad *self,
 				self->properties.bg_color->b,
 				self->properties.bg_color->a);
 
-		draw_solid(self, shader, GL_TRIANGLE_STRIP,
+		draw_vertex_array(self->vao, GL_TRIANGLE_STRIP,
 				ctx->window->local_storage.ibo.stylequad.solid, 4);
 	}
 
@@ -124,7 +110,7 @@ draw(struct rtb_render_context *ctx, const struct rtb_stylequad *self,
 
 		glLineWidth(1.f);
 
-		draw_solid(self, shader, GL_LINE_LOOP,
+		draw_vertex_array(self->vao, GL_LINE_LOOP,
 				ctx->window->local_storage.ibo.stylequad.outline, 4);
 	}
 }
@@ -146,7 +132,7 @@ rtb_stylequad_draw_solid(const struct rtb_stylequad *self,
 	rtb_render_set_position(ctx, center->x, center->y);
 	glUniform2f(shader->texture_size, 0.f, 0.f);
 
-	draw_solid(self, shader, GL_TRIANGLE_STRIP,
+	draw_vertex_array(self->vao, GL_TRIANGLE_STRIP,
 			ctx->window->local_storage.ibo.stylequad.solid, 4);
 }
 
@@ -157,6 +143,11 @@ rtb_stylequad_draw_on_element(struct rtb_stylequad *self,
 	struct rtb_shader *shader = &on->window->local_storage.shader.stylequad;
 	struct rtb_render_context *ctx = rtb_render_get_context(on);
 
+	if (ctx->batch) {
+		rtb_stylequad_batch_add(ctx->batch, ctx, self, on, NULL, mode);
+		return;
+	}
+
 	rtb_render_reset(on);
 	rtb_render_use_shader(ctx, shader);
 
@@ -170,6 +161,11 @@ rtb_stylequad_draw_with_modelview(struct rtb_stylequad *self, struct rtb_element
 	struct rtb_shader *shader = &on->window->local_storage.shader.stylequad;
 	struct rtb_render_context *ctx = rtb_render_get_context(on);
 
+	if (ctx->batch) {
+		rtb_stylequad_batch_add(ctx->batch, ctx, self, on, modelview, mode);
+		return;
+	}
+
 	rtb_render_reset(on);
 	rtb_render_use_shader(ctx, shader);
 	rtb_render_set_modelview(ctx, modelview->data);
@@ -181,6 +177,45 @@ rtb_stylequad_draw_with_modelview(struct rtb_stylequad *self, struct rtb_element
  * property/style wrangling
  */
 
+static void
+build_vertex_array(GLuint *vao, GLuint vertices, GLuint coords)
+{
+	if (!*vao)
+		glGenVertexArrays(1, vao);
+
+	glBindVertexArray(*vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertices);
+	glEnableVertexAttribArray(RTB_SHADER_ATTRIB_VERTEX);
+	glVertexAttribPointer(RTB_SHADER_ATTRIB_VERTEX,
+			2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	if (coords) {
+		glBindBuffer(GL_ARRAY_BUFFER, coords);
+		glEnableVertexAttribArray(RTB_SHADER_ATTRIB_TEX_COORD);
+		glVertexAttribPointer(RTB_SHADER_ATTRIB_TEX_COORD,
+				2, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+static void
+upload_tex_coords(struct rtb_stylequad_texture *tx, GLfloat (*v)[2],
+		size_t count)
+{
+	size_t i;
+
+	/* the image might be living somewhere inside an atlas page. */
+	for (i = 0; i < count; i++)
+		rtb_cached_texture_map(tx->cached, &v[i][0], &v[i][1]);
+
+	glBindBuffer(GL_ARRAY_BUFFER, tx->coords);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(*v), v, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 static void
 set_border_tex_coords(struct rtb_stylequad_texture *tx)
 {
@@ -216,9 +251,7 @@ set_border_tex_coords(struct rtb_stylequad_texture *tx)
 		{1.f - bdr_rgt, 0.f},
 	};
 
-	glBindBuffer(GL_ARRAY_BUFFER, tx->coords);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	upload_tex_coords(tx, v, ARRAY_LENGTH(v));
 }
 
 static void
@@ -231,51 +264,43 @@ set_background_tex_coords(struct rtb_stylequad_texture *tx)
 		[12] = {1.f, 0.f}
 	};
 
-	glBindBuffer(GL_ARRAY_BUFFER, tx->coords);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	upload_tex_coords(tx, v, ARRAY_LENGTH(v));
 }
 
 
 
 static int
-load_texture(struct rtb_stylequad_texture *dst,
+load_texture(struct rtb_stylequad *self, struct rtb_stylequad_texture *dst,
+		struct rtb_texture_cache *cache,
 		const struct rtb_style_texture_definition *src)
 {
+	struct rtb_cached_texture *cached = NULL;
+
 	if (dst->definition == src)
 		return -1;
 
+	if (src && !(cached =
+				rtb_texture_cache_ref(cache, src, RTB_TEXTURE_CACHE_ATLAS)))
+		return -1;
+
 	if (!dst->coords) {
 		glGenBuffers(1, &dst->coords);
-		glGenTextures(1, &dst->gl_handle);
+		build_vertex_array(&dst->vao, self->vertices, dst->coords);
 	}
 
-	glBindTexture(GL_TEXTURE_2D, dst->gl_handle);
-
-	if (!src) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 0, 0,
-				0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
-	} else {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
-				src->w, src->h,
-				0, GL_BGRA, GL_UNSIGNED_BYTE,
-				RTB_ASSET_DATA(RTB_ASSET(src)));
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	}
-
-	glBindTexture(GL_TEXTURE_2D, 0);
+	rtb_texture_cache_unref(dst->cached);
 
+	dst->cached = cached;
 	dst->definition = src;
 	return 0;
 }
 
 int
 rtb_stylequad_set_border_image(struct rtb_stylequad *self,
+		struct rtb_texture_cache *cache,
 		const struct rtb_style_texture_definition *tx)
 {
-	if (load_texture(&self->border_image, tx))
+	if (load_texture(self, &self->border_image, cache, tx))
 		return -1;
 
 	if (tx)
@@ -286,9 +311,10 @@ rtb_stylequad_set_border_image(struct rtb_stylequad *self,
 
 int
 rtb_stylequad_set_background_image(struct rtb_stylequad *self,
+		struct rtb_texture_cache *cache,
 		const struct rtb_style_texture_definition *tx)
 {
-	if (load_texture(&self->background_image, tx))
+	if (load_texture(self, &self->background_image, cache, tx))
 		return -1;
 
 	if (tx)
@@ -340,6 +366,7 @@ rtb_stylequad_update_geometry(struct rtb_stylequad *self,
 
 	self->offset.x = rect->x + r.x2;
 	self->offset.y = rect->y + r.y2;
+	self->size = rect->size;
 
 	glBindBuffer(GL_ARRAY_BUFFER, self->vertices);
 
@@ -387,6 +414,11 @@ rtb_stylequad_update_geometry(struct rtb_stylequad *self,
 	}
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	/* the vertex array only refers to the buffer by name, so it only
+	 * needs building the first time around. */
+	if (!self->vao)
+		build_vertex_array(&self->vao, self->vertices, 0);
 }
 
 /**
@@ -395,15 +427,17 @@ rtb_stylequad_update_geometry(struct rtb_stylequad *self,
 
 #define INIT_STYLEQUAD_TEXTURE(tx) do {										\
 	(tx)->definition = NULL;												\
+	(tx)->cached    = NULL;													\
 	(tx)->coords    = 0;													\
-	(tx)->gl_handle = 0;													\
+	(tx)->vao       = 0;													\
 } while (0)
 
 #define FINI_STYLEQUAD_TEXTURE(tx) do {										\
-	if ((tx)->coords) {														\
+	rtb_texture_cache_unref((tx)->cached);									\
+	if ((tx)->coords)														\
 		glDeleteBuffers(1, &(tx)->coords);									\
-		glDeleteTextures(1, &(tx)->gl_handle);								\
-	}																		\
+	if ((tx)->vao)															\
+		glDeleteVertexArrays(1, &(tx)->vao);								\
 } while (0)
 
 void
@@ -421,5 +455,7 @@ void rtb_stylequad_fini(struct rtb_stylequad *self)
 	FINI_STYLEQUAD_TEXTURE(&self->border_image);
 	FINI_STYLEQUAD_TEXTURE(&self->background_image);
 
+	if (self->vao)
+		glDeleteVertexArrays(1, &self->vao);
 	glDeleteBuffers(1, &self->vertices);
 }
@@ -25,6 +25,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <rutabaga/rutabaga.h>
@@ -45,7 +46,134 @@
  * internal stuff
  */
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, surface_impl;
+static struct rtb_type_class surface_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.surface");
+
+static void
+add_region(struct rtb_surface *self, const struct rtb_rect *rect)
+{
+	struct rtb_rect *regions = self->pending.regions;
+	struct rtb_rect region, grown;
+	float cost, best_cost;
+	int i, best;
+
+	if (!rtb_rect_intersect(&region, rect, &self->rect))
+		return;
+
+	/* overlapping regions would get painted twice, so we fold them into
+	 * one. that can make it overlap others, so start over each time. */
+	for (i = 0; i < self->pending.count;) {
+		if (!rtb_rect_intersects(&regions[i], &region)) {
+			i++;
+			continue;
+		}
+
+		rtb_rect_union(&region, &regions[i]);
+		regions[i] = regions[--self->pending.count];
+		i = 0;
+	}
+
+	if (self->pending.count < RTB_SURFACE_DAMAGE_REGIONS) {
+		regions[self->pending.count++] = region;
+		return;
+	}
+
+	/* out of room, so grow whichever region that costs the fewest extra
+	 * pixels. */
+	best = 0;
+	best_cost = INFINITY;
+
+	for (i = 0; i < self->pending.count; i++) {
+		grown = regions[i];
+		rtb_rect_union(&grown, &region);
+
+		cost = (grown.w * grown.h) - (regions[i].w * regions[i].h);
+		if (cost < best_cost) {
+			best = i;
+			best_cost = cost;
+		}
+	}
+
+	rtb_rect_union(&regions[best], &region);
+}
+
+static void
+clear_region(struct rtb_surface *self, const struct rtb_rect *region)
+{
+	struct rtb_render_state *state = &self->window->local_storage.state;
+	struct rtb_render_context *ctx = &self->render_ctx;
+
+	rtb_render_flush(ctx);
+
+	rtb_render_state_scissor(state,
+			region->x - self->x,
+			self->y + self->h - region->y2,
+			region->w, region->h);
+
+	glClearColor(ctx->clear_color[0], ctx->clear_color[1],
+			ctx->clear_color[2], ctx->clear_color[3]);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	ctx->element_state_stale = 1;
+}
+
+static void
+repaint_subtrees(struct rtb_surface *self)
+{
+	struct rtb_element *iter;
+
+	while ((iter = TAILQ_FIRST(&self->render_queue))) {
+		TAILQ_REMOVE(&self->render_queue, iter, render_entry);
+
+		iter->render_entry.tqe_next = NULL;
+		iter->render_entry.tqe_prev = NULL;
+
+		rtb_elem_draw(iter, 1);
+		rtb_rect_union(&self->damage, &iter->rect);
+
+		self->window->local_storage.state.stats.repainted_pixels +=
+			lrintf(iter->w * iter->h);
+	}
+}
+
+static void
+repaint_damage(struct rtb_surface *self)
+{
+	struct rtb_render_state *state = &self->window->local_storage.state;
+	struct rtb_render_context *ctx = &self->render_ctx;
+	struct rtb_element *iter;
+	struct rtb_rect *region;
+	int i;
+
+	while ((iter = TAILQ_FIRST(&self->render_queue))) {
+		TAILQ_REMOVE(&self->render_queue, iter, render_entry);
+
+		iter->render_entry.tqe_next = NULL;
+		iter->render_entry.tqe_prev = NULL;
+
+		add_region(self, &iter->rect);
+	}
+
+	/* each region gets cleared and then everything overlapping it is
+	 * drawn again, back to front, scissored to the region. elements
+	 * entirely outside of it are skipped by rtb_elem_draw(). */
+	for (i = 0; i < self->pending.count; i++) {
+		region = &self->pending.regions[i];
+
+		clear_region(self, region);
+
+		ctx->clip = region;
+		TAILQ_FOREACH(iter, &self->children, child)
+			rtb_elem_draw(iter, 0);
+		ctx->clip = NULL;
+
+		rtb_rect_union(&self->damage, region);
+		state->stats.repainted_pixels += lrintf(region->w * region->h);
+	}
+
+	self->pending.count = 0;
+}
 
 /**
  * element implementation
@@ -57,19 +185,17 @@ draw(struct rtb_element *elem)
 	SELF_FROM(elem);
 
 	rtb_surface_draw_children(self);
-	rtb_surface_blit(self);
+
+	if (!self->draw_in_place)
+		rtb_surface_blit(self);
 }
 
 static int
 reflow(struct rtb_element *elem, struct rtb_element *instigator,
 		rtb_ev_direction_t direction)
 {
-	struct rtb_rect tex_coords = {
-		.as_float = {
-			0.f, 1.f,
-			1.f, 0.f
-		}
-	};
+	struct rtb_rect tex_coords;
+	int w, h;
 
 	SELF_FROM(elem);
 	if (!super.reflow(elem, instigator, direction))
@@ -83,25 +209,55 @@ reflow(struct rtb_element *elem, struct rtb_element *instigator,
 			self->y + self->h, self->y,
 			-1.f, 1.f);
 
-	glBindTexture(GL_TEXTURE_2D, self->texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-			lrintf(self->w), lrintf(self->h), 0,
-			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_UNIFORM_BUFFER, self->render_ctx.frame_uniforms);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0,
+			sizeof(self->render_ctx.projection.data),
+			self->render_ctx.projection.data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	rtb_surface_invalidate(self);
+
+	/* nothing to allocate if we never draw offscreen. */
+	if (self->draw_in_place) {
+		if (self->target) {
+			rtb_render_target_release(self->target);
+			self->target = NULL;
+		}
+
+		return 1;
+	}
+
+	w = lrintf(self->w);
+	h = lrintf(self->h);
+
+	/* while it still fits, we keep drawing into the corner of the target
+	 * we've got. otherwise it goes back to the pool first so that we
+	 * might get it straight back. */
+	if (!self->target || !rtb_render_target_fits(self->target, w, h)) {
+		if (self->target)
+			rtb_render_target_release(self->target);
+
+		self->target = rtb_render_target_acquire(
+				&self->window->local_storage.targets, w, h);
+
+		/* callers take anything non-zero to mean that we reflowed.
+		 * without a target there's nothing to lay out for, and
+		 * drawing and blitting skip us until a later reflow gets
+		 * one. */
+		if (!self->target)
+			return 0;
+	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-			GL_TEXTURE_2D, self->texture, 0);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	/* we draw into the bottom-left w * h of the target, and the texture
+	 * is upside down relative to us. */
+	tex_coords.x  = 0.f;
+	tex_coords.y  = self->h / (float) self->target->h;
+	tex_coords.x2 = self->w / (float) self->target->w;
+	tex_coords.y2 = 0.f;
 
 	rtb_quad_set_vertices(&self->quad, &self->rect);
 	rtb_quad_set_tex_coords(&self->quad, &tex_coords);
 
-	rtb_surface_invalidate(self);
-
 	return 1;
 }
 
@@ -111,16 +267,22 @@ child_attached(struct rtb_element *elem, struct rtb_element *child)
 	SELF_FROM(elem);
 
 	child->surface = self;
-	child->attached(child, RTB_ELEMENT(self), self->window);
+	RTB_IMPL(child)->attached(child, RTB_ELEMENT(self), self->window);
 }
 
 static void
-attached(struct rtb_element *self,
+attached(struct rtb_element *elem,
 		struct rtb_element *parent, struct rtb_window *window)
 {
-	super.attached(self, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.surface");
+	SELF_FROM(elem);
+
+	super.attached(elem, parent, window);
+	self->type = rtb_type_ref_class(window, self->type,
+			&surface_type);
+
+	/* the render state lives on the window, and whoever pushes onto our
+	 * context can get there before our first draw does. */
+	self->render_ctx.window = window;
 }
 
 static void
@@ -140,7 +302,7 @@ int
 rtb_surface_is_dirty(struct rtb_surface *self)
 {
 	if (self->surface_state == RTB_SURFACE_VALID &&
-			!TAILQ_FIRST(&self->render_queue)) {
+			!TAILQ_FIRST(&self->render_queue) && !self->pending.count) {
 		/* nothing to do. */
 		return 0;
 	}
@@ -152,24 +314,31 @@ void
 rtb_surface_blit(struct rtb_surface *self)
 {
 	struct rtb_shader *shader = &self->window->local_storage.shader.surface;
+	struct rtb_render_state *state = &self->window->local_storage.state;
+	struct rtb_profiler *profiler = &self->window->local_storage.profiler;
 	struct rtb_element *elem = RTB_ELEMENT(self);
 	struct rtb_render_context *ctx;
 
+	if (!self->target)
+		return;
+
+	rtb_profiler_begin(profiler, RTB_PROFILE_BLIT);
+
 	ctx = rtb_render_get_context(elem);
 
 	rtb_render_reset(elem);
 	rtb_render_use_shader(ctx, shader);
 	rtb_render_set_position(ctx, 0, 0);
 
-	glBindTexture(GL_TEXTURE_2D, self->texture);
+	rtb_render_state_bind_texture(state, 0, GL_TEXTURE_2D,
+			self->target->texture);
 	glUniform1i(shader->texture, 0);
 
-	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	rtb_render_state_blend_func(state, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
 	rtb_render_quad(ctx, &self->quad);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	rtb_profiler_end(profiler, RTB_PROFILE_BLIT);
 
 	LAYOUT_DEBUG_DRAW_BOX(elem);
 }
@@ -177,21 +346,46 @@ rtb_surface_blit(struct rtb_surface *self)
 void
 rtb_surface_draw_children(struct rtb_surface *self)
 {
+	struct rtb_render_context *parent_ctx;
+	struct rtb_render_state *state;
+	struct rtb_profiler *profiler;
 	struct rtb_element *iter;
 
-	GLint bound_fb;
+	GLuint bound_fb;
 	GLint viewport[4];
 
+	self->damage = (struct rtb_rect) {.x = 0.f};
+
 	if (!rtb_surface_is_dirty(self))
 		return;
 
-	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound_fb);
-	glGetIntegerv(GL_VIEWPORT, viewport);
+	/* offscreen, but couldn't get a render target in reflow(). */
+	if (!self->draw_in_place && !self->target)
+		return;
+
+	profiler = &self->window->local_storage.profiler;
+	rtb_profiler_begin(profiler, RTB_PROFILE_SURFACE);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
-	glViewport(0, 0, self->w, self->h);
+	/* if we're nested inside another surface, anything it has queued
+	 * up needs to land in its framebuffer before we switch away. */
+	parent_ctx = rtb_render_get_context(RTB_ELEMENT(self));
+	if (parent_ctx != &self->render_ctx)
+		rtb_render_flush(parent_ctx);
+
+	/* these only go to the driver if nobody's told the state tracker
+	 * what's bound, which shouldn't happen mid-frame. */
+	state = &self->window->local_storage.state;
+	bound_fb = rtb_render_state_get_framebuffer(state);
+	rtb_render_state_get_viewport(state, viewport);
+
+	rtb_render_state_bind_framebuffer(state,
+			self->draw_in_place ? bound_fb : self->target->fbo);
+	rtb_render_state_viewport(state, 0, 0, self->w, self->h);
 
 	self->render_ctx.window = self->window;
+	self->render_ctx.batch = &self->batch;
+	self->render_ctx.element = NULL;
+	self->render_ctx.recording = NULL;
 
 	/* we have slightly different ways of handling this redraw depending
 	 * on what the state of the surface is. */
@@ -200,9 +394,11 @@ rtb_surface_draw_children(struct rtb_surface *self)
 		/* if we're marked as invalid, we clear the entire surface and
 		 * redraw it from scratch. */
 
-		glDisable(GL_SCISSOR_TEST);
+		rtb_render_state_scissor_test(state, 0);
 		rtb_render_clear(RTB_ELEMENT(self));
-		glEnable(GL_SCISSOR_TEST);
+		rtb_render_state_scissor_test(state, 1);
+
+		self->damage = self->rect;
 
 		/* first, we clean out the renderqueue for dirty elements (since
 		 * we're going to be redrawing everything anyway.) */
@@ -213,30 +409,38 @@ rtb_surface_draw_children(struct rtb_surface *self)
 			iter->render_entry.tqe_prev = NULL;
 		}
 
+		self->pending.count = 0;
+
 		/* then we draw all the children. */
 		TAILQ_FOREACH(iter, &self->children, child)
 			rtb_elem_draw(iter, 0);
 
+		state->stats.repainted_pixels += lrintf(self->w * self->h);
 		self->surface_state = RTB_SURFACE_VALID;
 		break;
 
 	case RTB_SURFACE_VALID:
 		/* if we're marked valid, we'll just do an incremental redraw
 		 * just of the elements which have requested it. */
-		while ((iter = TAILQ_FIRST(&self->render_queue))) {
-			TAILQ_REMOVE(&self->render_queue, iter, render_entry);
-
-			iter->render_entry.tqe_next = NULL;
-			iter->render_entry.tqe_prev = NULL;
-
-			rtb_elem_draw(iter, 1);
-		}
+		if (self->repaint_mode == RTB_SURFACE_REPAINT_DAMAGE)
+			repaint_damage(self);
+		else
+			repaint_subtrees(self);
 
 		break;
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, bound_fb);
-	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	rtb_render_flush(&self->render_ctx);
+	self->render_ctx.batch = NULL;
+
+	rtb_render_state_bind_framebuffer(state, bound_fb);
+	rtb_render_state_viewport(state,
+			viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	/* we've trampled over the scissor and blend state. */
+	parent_ctx->element_state_stale = 1;
+
+	rtb_profiler_end(profiler, RTB_PROFILE_SURFACE);
 }
 
 void
@@ -246,25 +450,81 @@ rtb_surface_invalidate(struct rtb_surface *self)
 	rtb_elem_mark_dirty(RTB_ELEMENT(self));
 }
 
+/**
+ * `rect` is in window coordinates, and whatever is in it gets redrawn on
+ * the next rtb_surface_draw_children().
+ */
+void
+rtb_surface_add_damage(struct rtb_surface *self, const struct rtb_rect *rect)
+{
+	struct rtb_element *iter;
+
+	if (self->surface_state == RTB_SURFACE_INVALID
+			|| !rtb_rect_intersects(rect, &self->rect))
+		return;
+
+	if (self->repaint_mode == RTB_SURFACE_REPAINT_DAMAGE)
+		add_region(self, rect);
+	else {
+		/* the closest we can get is redrawing whichever children
+		 * overlap it. */
+		TAILQ_FOREACH(iter, &self->children, child) {
+			if (!rtb_rect_intersects(&iter->rect, rect)
+					|| iter->render_entry.tqe_next
+					|| iter->render_entry.tqe_prev)
+				continue;
+
+			TAILQ_INSERT_TAIL(&self->render_queue, iter, render_entry);
+		}
+	}
+
+	rtb_elem_mark_dirty(RTB_ELEMENT(self));
+}
+
 int
 rtb_surface_init(struct rtb_surface *self)
 {
 	if (RTB_SUBCLASS(RTB_ELEMENT(self), rtb_elem_init, &super))
 		return -1;
 
-	self->impl = super;
-	self->impl.draw           = draw;
-	self->impl.reflow         = reflow;
-	self->impl.attached       = attached;
-	self->impl.mark_dirty     = mark_dirty;
-	self->impl.child_attached = child_attached;
+	if (!surface_impl.draw) {
+		surface_impl = super;
+		surface_impl.draw           = draw;
+		surface_impl.reflow         = reflow;
+		surface_impl.attached       = attached;
+		surface_impl.mark_dirty     = mark_dirty;
+		surface_impl.child_attached = child_attached;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &surface_impl);
 
 	TAILQ_INIT(&self->render_queue);
 
-	glGenTextures(1, &self->texture);
-	glGenFramebuffers(1, &self->fbo);
+	self->repaint_mode = RTB_SURFACE_REPAINT_DAMAGE;
+	self->pending.count = 0;
+	self->render_ctx.clip = NULL;
+	self->render_ctx.recording = NULL;
+
+	self->draw_in_place = 0;
+	self->damage = (struct rtb_rect) {.x = 0.f};
+	memset(self->render_ctx.clear_color, 0,
+			sizeof(self->render_ctx.clear_color));
+
+	if (rtb_stylequad_batch_init(&self->batch)) {
+		rtb_elem_fini(RTB_ELEMENT(self));
+		return -1;
+	}
+
+	self->target = NULL;
 	rtb_quad_init(&self->quad);
 
+	glGenBuffers(1, &self->render_ctx.frame_uniforms);
+	glBindBuffer(GL_UNIFORM_BUFFER, self->render_ctx.frame_uniforms);
+	glBufferData(GL_UNIFORM_BUFFER,
+			sizeof(self->render_ctx.projection.data), NULL,
+			GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
 	self->surface_state = RTB_SURFACE_INVALID;
 
 	return 0;
@@ -275,8 +535,11 @@ rtb_surface_fini(struct rtb_surface *self)
 {
 	rtb_quad_fini(&self->quad);
 
-	glDeleteFramebuffers(1, &self->fbo);
-	glDeleteTextures(1, &self->texture);
+	glDeleteBuffers(1, &self->render_ctx.frame_uniforms);
+	if (self->target)
+		rtb_render_target_release(self->target);
+
+	rtb_stylequad_batch_fini(&self->batch);
 
 	rtb_elem_fini(RTB_ELEMENT(self));
 }
@@ -149,6 +149,9 @@ rtb_font_manager_init(struct rtb_font_manager *fm, int dpi_x, int dpi_y)
 
 #undef CACHE_UNIFORM
 
+	fm->shader.subpixel_shift =
+		glGetAttribLocation(fm->shader.program, "subpixel_shift");
+
 	fm->cache_glyphs = NULL;
 
 #if defined(FT_CONFIG_OPTION_SUBPIXEL_RENDERING) || (FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && (FREETYPE_MINOR > 8 || (FREETYPE_MINOR == 8 && FREETYPE_PATCH >= 1))))
@@ -201,7 +201,8 @@ rtb_text_object_render(struct rtb_text_object *self,
 	atlas = fm->atlas;
 
 	rtb_render_use_shader(ctx, RTB_SHADER(shader));
-	glBindTexture(GL_TEXTURE_2D, atlas->id);
+	rtb_render_state_bind_texture(&ctx->window->local_storage.state,
+			0, GL_TEXTURE_2D, atlas->id);
 
 	glUniform1i(shader->texture, 0);
 	glUniform1f(shader->gamma, self->font->lcd_gamma);
@@ -209,7 +210,8 @@ rtb_text_object_render(struct rtb_text_object *self,
 	glUniform3f(shader->atlas_pixel,
 			1.f / atlas->width, 1.f / atlas->height, atlas->depth);
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	rtb_render_state_blend_func(&ctx->window->local_storage.state,
+			GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	glUniform2f(shader->offset, x, y);
 	rtb_render_set_color(ctx,
@@ -225,6 +227,13 @@ rtb_text_object_new(struct rtb_font_manager *fm)
 	self->fm = fm;
 	self->vertices = vertex_buffer_new("vertex:2f,tex_coord:2f,subpixel_shift:1f");
 
+	/* the vertex array gets built on the first upload, which happens
+	 * outside of drawing, so freetype-gl can't go asking whichever
+	 * program happens to be bound where the attributes are. */
+	self->vertices->attributes[0]->index = fm->shader.vertex;
+	self->vertices->attributes[1]->index = fm->shader.tex_coord;
+	self->vertices->attributes[2]->index = fm->shader.subpixel_shift;
+
 	return self;
 }
 
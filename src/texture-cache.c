@@ -0,0 +1,381 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/asset.h>
+#include <rutabaga/style.h>
+#include <rutabaga/texture-cache.h>
+
+#include "rtb_private/stdlib-allocator.h"
+#include "rtb_private/util.h"
+
+#include "wwrl/vector.h"
+
+#define GUTTER RTB_TEXTURE_ATLAS_GUTTER
+#define PAGE_SIZE RTB_TEXTURE_PAGE_SIZE
+
+/**
+ * nedtries stuff
+ */
+
+static size_t
+texture_key_func(const struct rtb_cached_texture *node)
+{
+	return (size_t) node->definition;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+NEDTRIE_GENERATE(static, rtb_texture_cache_trie, rtb_cached_texture,
+		trie_entry, texture_key_func,
+		NEDTRIE_NOBBLEZEROS(rtb_texture_cache_trie));
+#pragma GCC diagnostic pop
+
+/**
+ * uploading
+ */
+
+static void
+upload_rect(const struct rtb_style_texture_definition *definition,
+		int dst_x, int dst_y, int src_x, int src_y, int w, int h)
+{
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, src_x);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, src_y);
+
+	glTexSubImage2D(GL_TEXTURE_2D, 0, dst_x, dst_y, w, h,
+			GL_BGRA, GL_UNSIGNED_BYTE,
+			RTB_ASSET_DATA(RTB_ASSET(definition)));
+}
+
+static void
+upload_into_page(struct rtb_texture_page *page,
+		const struct rtb_style_texture_definition *definition, int x, int y)
+{
+	int w = definition->w, h = definition->h;
+
+	glBindTexture(GL_TEXTURE_2D, page->gl_handle);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+
+	upload_rect(definition, x, y, 0, 0, w, h);
+
+	/* linear filtering only ever reaches one texel past the edge, so
+	 * that's all of the gutter we bother filling in. */
+	upload_rect(definition, x - 1, y,     0,     0,     1, h);
+	upload_rect(definition, x + w, y,     w - 1, 0,     1, h);
+	upload_rect(definition, x,     y - 1, 0,     0,     w, 1);
+	upload_rect(definition, x,     y + h, 0,     h - 1, w, 1);
+
+	upload_rect(definition, x - 1, y - 1, 0,     0,     1, 1);
+	upload_rect(definition, x + w, y - 1, w - 1, 0,     1, 1);
+	upload_rect(definition, x - 1, y + h, 0,     h - 1, 1, 1);
+	upload_rect(definition, x + w, y + h, w - 1, h - 1, 1, 1);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static int
+upload_standalone(struct rtb_cached_texture *self)
+{
+	const struct rtb_style_texture_definition *definition = self->definition;
+	GLint filter, wrap;
+
+	glGenTextures(1, &self->gl_handle);
+	if (!self->gl_handle)
+		return -1;
+
+	filter = (self->flags & RTB_TEXTURE_CACHE_NEAREST)
+		? GL_NEAREST : GL_LINEAR;
+	wrap = (self->flags & RTB_TEXTURE_CACHE_REPEAT)
+		? GL_REPEAT : GL_CLAMP_TO_EDGE;
+
+	glBindTexture(GL_TEXTURE_2D, self->gl_handle);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
+			definition->w, definition->h,
+			0, GL_BGRA, GL_UNSIGNED_BYTE,
+			RTB_ASSET_DATA(RTB_ASSET(definition)));
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	self->page = NULL;
+	self->uv = (struct rtb_rect) {
+		.x = 0.f, .y = 0.f, .x2 = 1.f, .y2 = 1.f,
+		.w = 1.f, .h = 1.f
+	};
+
+	return 0;
+}
+
+/**
+ * atlas pages
+ */
+
+static struct rtb_texture_page *
+page_new(struct rtb_texture_cache *cache)
+{
+	struct rtb_texture_page *page;
+
+	page = calloc(1, sizeof(*page));
+	if (!page)
+		goto err_alloc;
+
+	glGenTextures(1, &page->gl_handle);
+	if (!page->gl_handle)
+		goto err_texture;
+
+	glBindTexture(GL_TEXTURE_2D, page->gl_handle);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, PAGE_SIZE, PAGE_SIZE,
+			0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	VECTOR_INIT(&page->shelves, &stdlib_allocator, 8);
+	TAILQ_INSERT_TAIL(&cache->pages, page, page_entry);
+
+	return page;
+
+err_texture:
+	free(page);
+err_alloc:
+	return NULL;
+}
+
+static void
+page_free(struct rtb_texture_cache *cache, struct rtb_texture_page *page)
+{
+	TAILQ_REMOVE(&cache->pages, page, page_entry);
+
+	glDeleteTextures(1, &page->gl_handle);
+	VECTOR_FREE(&page->shelves);
+	free(page);
+}
+
+static int
+page_pack(struct rtb_texture_page *page, int w, int h, int *x, int *y)
+{
+	struct rtb_texture_shelf *shelf, *best = NULL;
+	size_t i;
+
+	/* best fit by height among the shelves that still have room. */
+	for (i = 0; i < page->shelves.size; i++) {
+		shelf = &page->shelves.data[i];
+
+		if (shelf->h < h || (PAGE_SIZE - shelf->free_x) < w)
+			continue;
+
+		if (!best || shelf->h < best->h)
+			best = shelf;
+	}
+
+	if (!best) {
+		struct rtb_texture_shelf new_shelf = {
+			.y      = page->free_y,
+			.h      = h,
+			.free_x = 0
+		};
+
+		if ((PAGE_SIZE - page->free_y) < h)
+			return -1;
+
+		page->free_y += h;
+
+		VECTOR_PUSH_BACK(&page->shelves, &new_shelf);
+		best = VECTOR_BACK(&page->shelves);
+	}
+
+	*x = best->free_x;
+	*y = best->y;
+
+	best->free_x += w;
+	return 0;
+}
+
+static int
+place_in_atlas(struct rtb_texture_cache *cache,
+		struct rtb_cached_texture *self)
+{
+	const struct rtb_style_texture_definition *definition = self->definition;
+	struct rtb_texture_page *page;
+	int x, y, slot_w, slot_h;
+
+	slot_w = definition->w + (2 * GUTTER);
+	slot_h = definition->h + (2 * GUTTER);
+
+	TAILQ_FOREACH(page, &cache->pages, page_entry)
+		if (!page_pack(page, slot_w, slot_h, &x, &y))
+			goto found;
+
+	if (!(page = page_new(cache)))
+		return -1;
+
+	if (page_pack(page, slot_w, slot_h, &x, &y)) {
+		page_free(cache, page);
+		return -1;
+	}
+
+found:
+	x += GUTTER;
+	y += GUTTER;
+
+	upload_into_page(page, definition, x, y);
+	page->refcount++;
+
+	self->page = page;
+	self->gl_handle = page->gl_handle;
+
+	self->uv.x  = x / (GLfloat) PAGE_SIZE;
+	self->uv.y  = y / (GLfloat) PAGE_SIZE;
+	self->uv.w  = definition->w / (GLfloat) PAGE_SIZE;
+	self->uv.h  = definition->h / (GLfloat) PAGE_SIZE;
+	rtb_rect_update_points_from_size(&self->uv);
+
+	return 0;
+}
+
+static int
+can_share(const struct rtb_style_texture_definition *definition,
+		rtb_texture_cache_flags_t flags)
+{
+	if (!(flags & RTB_TEXTURE_CACHE_ATLAS)
+			|| flags & (RTB_TEXTURE_CACHE_NEAREST | RTB_TEXTURE_CACHE_REPEAT))
+		return 0;
+
+	return definition->w <= RTB_TEXTURE_ATLAS_MAX_IMAGE
+		&& definition->h <= RTB_TEXTURE_ATLAS_MAX_IMAGE;
+}
+
+/**
+ * public API
+ */
+
+struct rtb_cached_texture *
+rtb_texture_cache_ref(struct rtb_texture_cache *self,
+		const struct rtb_style_texture_definition *definition,
+		rtb_texture_cache_flags_t flags)
+{
+	struct rtb_cached_texture needle = {.definition = definition}, *tx;
+	int err;
+
+	tx = NEDTRIE_FIND(rtb_texture_cache_trie, &self->textures, &needle);
+
+	/* the same asset can be in here more than once if it's been asked
+	 * for with different flags. those share a key, and FIND hands back
+	 * the second entry of the run, so back up to the first before
+	 * walking it. */
+	if (tx && NEDTRIE_PREVLEAF(rtb_texture_cache_trie, tx))
+		tx = NEDTRIE_PREVLEAF(rtb_texture_cache_trie, tx);
+
+	while (tx && (tx->definition != definition || tx->flags != flags))
+		tx = NEDTRIE_NEXTLEAF(rtb_texture_cache_trie, tx);
+
+	if (tx) {
+		tx->refcount++;
+		return tx;
+	}
+
+	if (!(tx = calloc(1, sizeof(*tx))))
+		return NULL;
+
+	tx->definition = definition;
+	tx->flags = flags;
+	tx->cache = self;
+
+	if (can_share(definition, flags))
+		err = place_in_atlas(self, tx);
+	else
+		err = upload_standalone(tx);
+
+	if (err) {
+		free(tx);
+		return NULL;
+	}
+
+	NEDTRIE_INSERT(rtb_texture_cache_trie, &self->textures, tx);
+
+	tx->refcount = 1;
+	return tx;
+}
+
+static void
+release(struct rtb_cached_texture *tx)
+{
+	struct rtb_texture_cache *cache = tx->cache;
+
+	NEDTRIE_REMOVE(rtb_texture_cache_trie, &cache->textures, tx);
+
+	if (tx->page) {
+		if (!--tx->page->refcount)
+			page_free(cache, tx->page);
+	} else
+		glDeleteTextures(1, &tx->gl_handle);
+
+	free(tx);
+}
+
+void
+rtb_texture_cache_unref(struct rtb_cached_texture *tx)
+{
+	if (!tx || --tx->refcount)
+		return;
+
+	release(tx);
+}
+
+int
+rtb_texture_cache_init(struct rtb_texture_cache *self)
+{
+	NEDTRIE_INIT(&self->textures);
+	TAILQ_INIT(&self->pages);
+
+	return 0;
+}
+
+void
+rtb_texture_cache_fini(struct rtb_texture_cache *self)
+{
+	struct rtb_cached_texture *tx, *next;
+
+	NEDTRIE_FOREACH_SAFE(tx, rtb_texture_cache_trie, &self->textures, next)
+		release(tx);
+}
@@ -42,7 +42,9 @@
 #define SELF_FROM(elem) \
 	struct rtb_button *self = RTB_ELEMENT_AS(elem, rtb_button)
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, button_impl;
+static struct rtb_type_class button_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.button");
 
 /**
  * event handlers
@@ -126,8 +128,8 @@ attached(struct rtb_element *elem,
 	SELF_FROM(elem);
 
 	super.attached(elem, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.widgets.button");
+	self->type = rtb_type_ref_class(window, self->type,
+			&button_type);
 
 	self->outer_pad.x = self->label.outer_pad.x;
 	self->outer_pad.y = self->label.outer_pad.y;
@@ -157,11 +159,17 @@ rtb_button_init(struct rtb_button *self)
 	self->outer_pad.x =
 		self->outer_pad.y = 0.f;
 
-	self->on_event  = on_event;
-	self->attached  = attached;
+	if (!button_impl.draw) {
+		button_impl = super;
+		button_impl.on_event = on_event;
+		button_impl.attached = attached;
+		button_impl.reflow   = reflow;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &button_impl);
+
 	self->layout_cb = rtb_layout_hpack_center;
 	self->size_cb   = rtb_size_hfit_children;
-	self->reflow    = reflow;
 
 	return 0;
 }
@@ -49,7 +49,9 @@
 #define MAX_DEGREES (360.f - MIN_DEGREES)
 #define DEGREE_RANGE (MAX_DEGREES - MIN_DEGREES)
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, knob_impl;
+static struct rtb_type_class knob_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.knob");
 
 /**
  * drawing
@@ -88,8 +90,8 @@ attached(struct rtb_element *elem,
 	SELF_FROM(elem);
 
 	super.attached(elem, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.widgets.knob");
+	self->type = rtb_type_ref_class(window, self->type,
+			&knob_type);
 
 	set_value_hook(elem, 1);
 }
@@ -104,8 +106,8 @@ restyle(struct rtb_element *elem)
 
 	prop = rtb_style_query_prop(elem,
 			"-rtb-knob-rotor", RTB_STYLE_PROP_TEXTURE, 0);
-	if (prop &&
-			!rtb_stylequad_set_background_image(&self->rotor, &prop->texture))
+	if (prop && !rtb_stylequad_set_background_image(&self->rotor,
+				&elem->window->local_storage.textures, &prop->texture))
 		rtb_elem_mark_dirty(elem);
 }
 
@@ -132,10 +134,15 @@ rtb_knob_init(struct rtb_knob *self)
 	if (RTB_SUBCLASS(RTB_VALUE_ELEMENT(self), rtb_value_element_init, &super))
 		return -1;
 
-	self->draw     = draw;
-	self->attached = attached;
-	self->restyle  = restyle;
-	self->reflow   = reflow;
+	if (!knob_impl.draw) {
+		knob_impl = super;
+		knob_impl.draw     = draw;
+		knob_impl.attached = attached;
+		knob_impl.restyle  = restyle;
+		knob_impl.reflow   = reflow;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &knob_impl);
 
 	self->set_value_hook = set_value_hook;
 
@@ -39,7 +39,9 @@
 #define SELF_FROM(elem) \
 	struct rtb_label *self = RTB_ELEMENT_AS(elem, rtb_label)
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, label_impl;
+static struct rtb_type_class label_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.label");
 
 static void
 draw(struct rtb_element *elem)
@@ -57,8 +59,8 @@ attached(struct rtb_element *elem,
 	SELF_FROM(elem);
 
 	super.attached(elem, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.widgets.label");
+	self->type = rtb_type_ref_class(window, self->type,
+			&label_type);
 
 	self->tobj = rtb_text_object_new(&window->font_manager);
 }
@@ -155,12 +157,17 @@ rtb_label_init(struct rtb_label *self)
 	if (RTB_SUBCLASS(RTB_ELEMENT(self), rtb_elem_init, &super))
 		return -1;
 
-	self->impl = super;
-	self->impl.draw     = draw;
-	self->impl.attached = attached;
-	self->impl.detached = detached;
-	self->impl.size_cb  = size;
-	self->impl.restyle  = restyle;
+	if (!label_impl.draw) {
+		label_impl = super;
+		label_impl.draw     = draw;
+		label_impl.attached = attached;
+		label_impl.detached = detached;
+		label_impl.restyle  = restyle;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &label_impl);
+
+	self->size_cb = size;
 
 	self->text = NULL;
 	self->tobj = NULL;
@@ -40,12 +40,15 @@
 #include <rutabaga/mouse.h>
 #include <rutabaga/style.h>
 #include <rutabaga/asset.h>
+#include <rutabaga/texture-cache.h>
 
 #include <rutabaga/widgets/patchbay.h>
 
+#include "rtb_private/stdlib-allocator.h"
 #include "rtb_private/util.h"
 
 #include "shaders/patchbay-canvas.glsl.h"
+#include "shaders/patchbay-cable.glsl.h"
 
 #define SELF_FROM(elem) \
 	struct rtb_patchbay *self = RTB_ELEMENT_AS(elem, rtb_patchbay)
@@ -53,7 +56,12 @@
 #define CONNECTION_COLOR	RTB_RGB(0x404F3C)
 #define DISCONNECT_COLOR	RTB_RGB(0x69181B)
 
-static struct rtb_element_implementation super;
+/* cables are 3.5px wide, plus a pixel of antialiasing either side */
+#define CABLE_HALF_WIDTH	1.75f
+
+static struct rtb_element_implementation super, patchbay_impl;
+static struct rtb_type_class patchbay_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.patchbay");
 
 /**
  * custom openGL stuff
@@ -75,6 +83,22 @@ static struct {
 	.program = 0
 };
 
+static struct {
+	RTB_INHERIT(rtb_shader);
+
+	struct {
+		GLint cables;
+		GLint half_width;
+	} uniform;
+} cable_shader = {
+	.program = 0
+};
+
+/* (along, across) for each corner of a cable's quad */
+static const GLfloat cable_corners[4][2] = {
+	{0.f, -1.f}, {1.f, -1.f}, {0.f, 1.f}, {1.f, 1.f}
+};
+
 static void
 init_shaders()
 {
@@ -96,28 +120,39 @@ init_shaders()
 	CACHE_UNIFORM_LOCATION(front_color);
 	CACHE_UNIFORM_LOCATION(back_color);
 #undef CACHE_UNIFORM_LOCATION
+
+	if (!rtb_shader_create(RTB_SHADER(&cable_shader),
+				PATCHBAY_CABLE_VERT_SHADER, NULL,
+				PATCHBAY_CABLE_FRAG_SHADER))
+		puts("rtb_patchbay: init_shaders() failed!");
+
+	cable_shader.uniform.cables =
+		glGetUniformLocation(cable_shader.program, "cables");
+	cable_shader.uniform.half_width =
+		glGetUniformLocation(cable_shader.program, "half_width");
 }
 
 static void
-load_tile(const struct rtb_style_texture_definition *definition,
-		GLuint into_texture)
+load_tile(struct rtb_patchbay *self,
+		const struct rtb_style_texture_definition *definition)
 {
+	struct rtb_cached_texture *tile;
+
 	if (!RTB_ASSET_IS_LOADED(RTB_ASSET(definition))) {
 		printf(" [!] couldn't load tile, aiee!\n");
 		return;
 	}
 
-	glBindTexture(GL_TEXTURE_2D, into_texture);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
-			definition->w, definition->h,
-			0, GL_BGRA, GL_UNSIGNED_BYTE,
-			RTB_ASSET_DATA(RTB_ASSET(definition)));
+	if (self->bg_texture && self->bg_texture->definition == definition)
+		return;
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	/* the background is tiled across the whole canvas, so it can't live
+	 * in an atlas page. */
+	tile = rtb_texture_cache_ref(&self->window->local_storage.textures,
+			definition, RTB_TEXTURE_CACHE_NEAREST | RTB_TEXTURE_CACHE_REPEAT);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	rtb_texture_cache_unref(self->bg_texture);
+	self->bg_texture = tile;
 }
 
 /**
@@ -146,7 +181,7 @@ cache_to_vbo(struct rtb_patchbay *self)
 	box[3][0] = x;
 	box[3][1] = y + h;
 
-	glBindBuffer(GL_ARRAY_BUFFER, self->bg_vbo[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, self->bg_vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(box), box, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
@@ -163,14 +198,17 @@ draw_bg(struct rtb_patchbay *self)
 	rtb_render_set_position(ctx, 0, 0);
 
 	/* draw the background */
-	glBindBuffer(GL_ARRAY_BUFFER, self->bg_vbo[0]);
+	glBindVertexArray(self->window->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, self->bg_vbo);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
 
 	prop = rtb_style_query_prop(RTB_ELEMENT(self),
 			"background-image", RTB_STYLE_PROP_TEXTURE, 1);
 
-	glBindTexture(GL_TEXTURE_2D, self->bg_texture);
+	rtb_render_state_bind_texture(&self->window->local_storage.state,
+			0, GL_TEXTURE_2D,
+			self->bg_texture ? self->bg_texture->gl_handle : 0);
 	glUniform1i(shader.uniform.texture, 0);
 	glUniform2f(shader.uniform.tx_size, prop->texture.w, prop->texture.h);
 	glUniform2f(shader.uniform.tx_offset,
@@ -205,100 +243,222 @@ draw_bg(struct rtb_patchbay *self)
 
 	glDisableVertexAttribArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static int
+init_cables(struct rtb_patchbay *self)
+{
+	glGenBuffers(1, &self->cables.corners);
+	if (!self->cables.corners)
+		goto err_corners;
+
+	glGenVertexArrays(1, &self->cables.vao);
+	if (!self->cables.vao)
+		goto err_vao;
+
+	glGenBuffers(1, &self->cables.buffer);
+	if (!self->cables.buffer)
+		goto err_buffer;
+
+	glGenTextures(1, &self->cables.texture);
+	if (!self->cables.texture)
+		goto err_texture;
+
+	glBindVertexArray(self->cables.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, self->cables.corners);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cable_corners), cable_corners,
+			GL_STATIC_DRAW);
+	glEnableVertexAttribArray(RTB_SHADER_ATTRIB_VERTEX);
+	glVertexAttribPointer(RTB_SHADER_ATTRIB_VERTEX,
+			2, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, self->cables.buffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(struct rtb_patchbay_cable),
+			NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_BUFFER, self->cables.texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, self->cables.buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	VECTOR_INIT(&self->cables.instances, &stdlib_allocator, 16);
+
+	self->cables.dirty = 1;
+	self->cables.in_progress = -1;
+	self->cables.disconnecting = 0;
+
+	return 0;
+
+err_texture:
+	glDeleteBuffers(1, &self->cables.buffer);
+err_buffer:
+	glDeleteVertexArrays(1, &self->cables.vao);
+err_vao:
+	glDeleteBuffers(1, &self->cables.corners);
+err_corners:
+	return -1;
 }
 
 static void
-draw_line(GLfloat line[2][2])
+fini_cables(struct rtb_patchbay *self)
 {
-	glBufferData(GL_ARRAY_BUFFER,
-			sizeof(GLfloat[2][2]), line, GL_STREAM_DRAW);
+	VECTOR_FREE(&self->cables.instances);
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glDeleteTextures(1, &self->cables.texture);
+	glDeleteBuffers(1, &self->cables.buffer);
+	glDeleteVertexArrays(1, &self->cables.vao);
+	glDeleteBuffers(1, &self->cables.corners);
+}
+
+static void
+port_anchor(const struct rtb_patchbay_port *port, GLfloat *x, GLfloat *y)
+{
+	*x = (port->port_type == PORT_TYPE_OUTPUT) ? port->x + port->w : port->x;
+	*y = port->y + floorf(port->h / 2.f);
+}
 
-	glDrawArrays(GL_LINES, 0, 2);
+static void
+set_cable(struct rtb_patchbay_cable *cable,
+		GLfloat from_x, GLfloat from_y, GLfloat to_x, GLfloat to_y,
+		GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+	cable->endpoints[0] = from_x;
+	cable->endpoints[1] = from_y;
+	cable->endpoints[2] = to_x;
+	cable->endpoints[3] = to_y;
+
+	cable->color[0] = r;
+	cable->color[1] = g;
+	cable->color[2] = b;
+	cable->color[3] = a;
 }
 
 static void
-draw_patches(struct rtb_patchbay *self)
+in_progress_cable(struct rtb_patchbay *self, struct rtb_patchbay_cable *cable)
 {
-	GLfloat line[2][2];
-	int disconnect_in_progress = 0;
-	struct rtb_patchbay_patch *iter;
 	struct rtb_patchbay_port *from, *to;
-	struct rtb_element *elem = RTB_ELEMENT(self);
-	struct rtb_render_context *ctx;
+	GLfloat from_x, from_y, to_x, to_y;
 
-	rtb_render_reset(elem);
-	ctx = rtb_render_get_context(elem);
-	rtb_render_set_position(ctx, 0, 0);
+	from = self->patch_in_progress.from;
+	to   = self->patch_in_progress.to;
 
-	glEnable(GL_LINE_SMOOTH);
-	glLineWidth(3.5f);
-	glBindBuffer(GL_ARRAY_BUFFER, self->bg_vbo[1]);
+	port_anchor(from, &from_x, &from_y);
+
+	if (to)
+		port_anchor(to, &to_x, &to_y);
+	else {
+		to_x = self->patch_in_progress.cursor.x;
+		to_y = self->patch_in_progress.cursor.y;
+	}
+
+	if (self->cables.disconnecting)
+		set_cable(cable, from_x, from_y, to_x, to_y, DISCONNECT_COLOR, .9f);
+	else if (to)
+		set_cable(cable, from_x, from_y, to_x, to_y, CONNECTION_COLOR, .8f);
+	else
+		set_cable(cable, from_x, from_y, to_x, to_y, CONNECTION_COLOR, .4f);
+}
+
+static void
+build_cables(struct rtb_patchbay *self)
+{
+	struct rtb_patchbay_port *from, *to;
+	struct rtb_patchbay_cable cable;
+	struct rtb_patchbay_patch *iter;
+	GLfloat from_x, from_y, to_x, to_y, alpha;
+
+	VECTOR_CLEAR(&self->cables.instances);
+	self->cables.in_progress = -1;
+	self->cables.disconnecting = 0;
 
 	TAILQ_FOREACH(iter, &self->patches, patchbay_patch) {
 		from = iter->from;
 		to   = iter->to;
 
-		line[0][0] = from->x + from->w;
-		line[0][1] = from->y + floorf(from->h / 2.f);
-		line[1][0] = to->x;
-		line[1][1] = to->y + floorf(to->h / 2.f);
-
 		if ((self->patch_in_progress.from == from &&
 					self->patch_in_progress.to == to) ||
 				(self->patch_in_progress.from == to &&
 				 self->patch_in_progress.to == from)) {
-			disconnect_in_progress = 1;
+			self->cables.disconnecting = 1;
 			continue;
 		} else if (self->patch_in_progress.from == from ||
 				self->patch_in_progress.from == to)
-			rtb_render_set_color(ctx, CONNECTION_COLOR, .9f);
+			alpha = .9f;
 		else
-			rtb_render_set_color(ctx, CONNECTION_COLOR, .6f);
+			alpha = .6f;
+
+		port_anchor(from, &from_x, &from_y);
+		port_anchor(to, &to_x, &to_y);
 
-		draw_line(line);
+		set_cable(&cable, from_x, from_y, to_x, to_y,
+				CONNECTION_COLOR, alpha);
+		VECTOR_PUSH_BACK(&self->cables.instances, &cable);
 	}
 
+	/* the cable being dragged around goes last, so that it's on top
+	 * and so that it can be updated by itself. */
 	if (self->patch_in_progress.from) {
-		from = self->patch_in_progress.from;
-		to   = self->patch_in_progress.to;
-
-		if (from->port_type == PORT_TYPE_OUTPUT) {
-			line[0][0] = from->x + from->w;
-			line[0][1] = from->y + floorf(from->h / 2.f);
-		} else {
-			line[0][0] = from->x;
-			line[0][1] = from->y + floorf(from->h / 2.f);
-		}
-
-		if (to) {
-			if (to->port_type == PORT_TYPE_OUTPUT) {
-				line[1][0] = to->x + to->w;
-				line[1][1] = to->y + floorf(to->h / 2.f);
-			} else {
-				line[1][0] = to->x;
-				line[1][1] = to->y + floorf(to->h / 2.f);
-			}
-		} else {
-			line[1][0] = self->patch_in_progress.cursor.x;
-			line[1][1] = self->patch_in_progress.cursor.y;
-		}
-
-		if (disconnect_in_progress)
-			rtb_render_set_color(ctx, DISCONNECT_COLOR, .9f);
-		else if (to)
-			rtb_render_set_color(ctx, CONNECTION_COLOR, .8f);
-		else
-			rtb_render_set_color(ctx, CONNECTION_COLOR, .4f);
+		in_progress_cable(self, &cable);
 
-		draw_line(line);
+		self->cables.in_progress = self->cables.instances.size;
+		VECTOR_PUSH_BACK(&self->cables.instances, &cable);
 	}
 
-	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, self->cables.buffer);
+	glBufferData(GL_TEXTURE_BUFFER,
+			self->cables.instances.size * sizeof(cable),
+			self->cables.instances.data, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	self->cables.dirty = 0;
+}
+
+static void
+update_in_progress_cable(struct rtb_patchbay *self)
+{
+	struct rtb_patchbay_cable *cable;
+
+	cable = &self->cables.instances.data[self->cables.in_progress];
+	in_progress_cable(self, cable);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, self->cables.buffer);
+	glBufferSubData(GL_TEXTURE_BUFFER,
+			self->cables.in_progress * sizeof(*cable), sizeof(*cable),
+			cable);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+static void
+draw_patches(struct rtb_patchbay *self)
+{
+	struct rtb_element *elem = RTB_ELEMENT(self);
+	struct rtb_render_state *state = &self->window->local_storage.state;
+	struct rtb_render_context *ctx;
+
+	/* the cables only get rebuilt when something about them changes.
+	 * the one following the mouse around is the exception. */
+	if (self->cables.dirty)
+		build_cables(self);
+	else if (self->cables.in_progress >= 0)
+		update_in_progress_cable(self);
+
+	if (!self->cables.instances.size)
+		return;
+
+	rtb_render_reset(elem);
+	ctx = rtb_render_get_context(elem);
+	rtb_render_use_shader(ctx, RTB_SHADER(&cable_shader));
+
+	rtb_render_state_bind_texture(state,
+			0, GL_TEXTURE_BUFFER, self->cables.texture);
+	glUniform1i(cable_shader.uniform.cables, 0);
+	glUniform1f(cable_shader.uniform.half_width, CABLE_HALF_WIDTH);
+
+	glBindVertexArray(self->cables.vao);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+			self->cables.instances.size);
 }
 
 static void
@@ -326,6 +486,7 @@ reflow(struct rtb_element *elem,
 
 	rtb_surface_invalidate(RTB_SURFACE(self));
 	cache_to_vbo(self);
+	self->cables.dirty = 1;
 
 	return 1;
 }
@@ -343,6 +504,8 @@ reposition(struct rtb_patchbay *self, struct rtb_point *by)
 				RTB_DIRECTION_LEAFWARD);
 	}
 
+	rtb_elem_cull_children(RTB_ELEMENT(self));
+
 	self->texture_offset.x -= by->x;
 	self->texture_offset.y -= by->y;
 
@@ -395,8 +558,8 @@ attached(struct rtb_element *elem,
 	SELF_FROM(elem);
 
 	super.attached(elem, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.widgets.patchbay");
+	self->type = rtb_type_ref_class(window, self->type,
+			&patchbay_type);
 
 	cache_to_vbo(self);
 }
@@ -415,7 +578,7 @@ restyle(struct rtb_element *elem)
 			"background-image", RTB_STYLE_PROP_TEXTURE, 0);
 
 	if (prop)
-		load_tile(&prop->texture, self->bg_texture);
+		load_tile(self, &prop->texture);
 
 	if (!old_style)
 		rtb_layout_vpack_top(elem);
@@ -443,12 +606,22 @@ rtb_patchbay_init(struct rtb_patchbay *self)
 
 	TAILQ_INIT(&self->patches);
 
-	self->draw      = draw;
-	self->on_event  = on_event;
-	self->attached  = attached;
+	if (!patchbay_impl.draw) {
+		patchbay_impl = super;
+		patchbay_impl.draw     = draw;
+		patchbay_impl.on_event = on_event;
+		patchbay_impl.attached = attached;
+		patchbay_impl.reflow   = reflow;
+		patchbay_impl.restyle  = restyle;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &patchbay_impl);
+
 	self->layout_cb = layout;
-	self->reflow    = reflow;
-	self->restyle   = restyle;
+
+	/* patchbays get big, and every motion event during patching has
+	 * to find the node (and then port) under the cursor. */
+	self->flags |= RTB_ELEM_INDEX_CHILDREN;
 
 	init_shaders();
 
@@ -457,8 +630,14 @@ rtb_patchbay_init(struct rtb_patchbay *self)
 	self->texture_offset.x =
 		self->texture_offset.y = 0.f;
 
-	glGenTextures(1, &self->bg_texture);
-	glGenBuffers(2, self->bg_vbo);
+	self->bg_texture = NULL;
+	glGenBuffers(1, &self->bg_vbo);
+
+	if (init_cables(self)) {
+		glDeleteBuffers(1, &self->bg_vbo);
+		rtb_surface_fini(RTB_SURFACE(self));
+		return -1;
+	}
 
 	return 0;
 }
@@ -466,7 +645,9 @@ rtb_patchbay_init(struct rtb_patchbay *self)
 void
 rtb_patchbay_fini(struct rtb_patchbay *self)
 {
-	glDeleteTextures(1, &self->bg_texture);
+	rtb_texture_cache_unref(self->bg_texture);
+	fini_cables(self);
+	glDeleteBuffers(1, &self->bg_vbo);
 	rtb_surface_fini(RTB_SURFACE(self));
 }
 
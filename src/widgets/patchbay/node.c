@@ -39,7 +39,9 @@
 
 #define LABEL_PADDING		15.f
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, node_impl;
+static struct rtb_type_class node_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.patchbay.node");
 
 /**
  * element implementation
@@ -88,8 +90,8 @@ attached(struct rtb_element *elem,
 	self->patchbay = (struct rtb_patchbay *) parent;
 
 	super.attached(elem, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.widgets.patchbay.node");
+	self->type = rtb_type_ref_class(window, self->type,
+			&node_type);
 }
 
 static void
@@ -122,8 +124,14 @@ rtb_patchbay_node_init(struct rtb_patchbay_node *self)
 	if (RTB_SUBCLASS(RTB_ELEMENT(self), rtb_elem_init, &super))
 		return -1;
 
-	self->on_event  = on_event;
-	self->attached  = attached;
+	if (!node_impl.draw) {
+		node_impl = super;
+		node_impl.on_event = on_event;
+		node_impl.attached = attached;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &node_impl);
+
 	self->size_cb   = size;
 	self->layout_cb = rtb_layout_vpack_top;
 
@@ -35,7 +35,9 @@
 
 #include "rtb_private/util.h"
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, port_impl;
+static struct rtb_type_class port_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.patchbay.port");
 
 #define SELF_FROM(elem) \
 	struct rtb_patchbay_port *self = RTB_ELEMENT_AS(elem, rtb_patchbay_port)
@@ -129,6 +131,8 @@ start_patching(struct rtb_patchbay_port *self, const struct rtb_mouse_event *e)
 
 	patchbay->patch_in_progress.cursor.x = e->cursor.x;
 	patchbay->patch_in_progress.cursor.y = e->cursor.y;
+
+	patchbay->cables.dirty = 1;
 }
 
 static void
@@ -138,6 +142,8 @@ stop_patching(struct rtb_patchbay_port *self)
 
 	patchbay->patch_in_progress.from = NULL;
 	patchbay->patch_in_progress.to   = NULL;
+
+	patchbay->cables.dirty = 1;
 }
 
 static int
@@ -156,12 +162,15 @@ handle_drag(struct rtb_patchbay_port *self, const struct rtb_drag_event *e)
 
 		case RTB_DRAG_ENTER:
 			if (patchbay->patch_in_progress.from &&
-					patchbay->patch_in_progress.from->port_type != self->port_type)
+					patchbay->patch_in_progress.from->port_type != self->port_type) {
 				patchbay->patch_in_progress.to = self;
+				patchbay->cables.dirty = 1;
+			}
 			return 1;
 
 		case RTB_DRAG_LEAVE:
 			patchbay->patch_in_progress.to = NULL;
+			patchbay->cables.dirty = 1;
 			return 1;
 
 		case RTB_DRAG_DROP:
@@ -215,8 +224,24 @@ attached(struct rtb_element *elem,
 	SELF_FROM(elem);
 
 	super.attached(RTB_ELEMENT(self), parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.widgets.patchbay.port");
+	self->type = rtb_type_ref_class(window, self->type,
+			&port_type);
+}
+
+static int
+reflow(struct rtb_element *elem,
+		struct rtb_element *instigator, rtb_ev_direction_t direction)
+{
+	SELF_FROM(elem);
+	int ret;
+
+	ret = super.reflow(elem, instigator, direction);
+
+	/* our patches' cables start and end wherever we are. */
+	if (self->node && self->node->patchbay && TAILQ_FIRST(&self->patches))
+		self->node->patchbay->cables.dirty = 1;
+
+	return ret;
 }
 
 static int
@@ -283,6 +308,8 @@ rtb_patchbay_free_patch(struct rtb_patchbay *self,
 	TAILQ_REMOVE(&self->patches, patch, patchbay_patch);
 
 	free(patch);
+
+	self->cables.dirty = 1;
 	rtb_elem_mark_dirty(RTB_ELEMENT(self));
 }
 
@@ -340,6 +367,7 @@ rtb_patchbay_connect_ports(struct rtb_patchbay *self,
 	TAILQ_INSERT_TAIL(&from->patches, patch, from_patch);
 	TAILQ_INSERT_TAIL(&self->patches, patch, patchbay_patch);
 
+	self->cables.dirty = 1;
 	rtb_elem_mark_dirty(RTB_ELEMENT(self));
 	return patch;
 }
@@ -362,8 +390,15 @@ rtb_patchbay_port_init(struct rtb_patchbay_port *self,
 	self->port_type  = type;
 	self->node       = node;
 
-	self->attached  = attached;
-	self->on_event  = on_event;
+	if (!port_impl.draw) {
+		port_impl = super;
+		port_impl.attached = attached;
+		port_impl.on_event = on_event;
+		port_impl.reflow   = reflow;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &port_impl);
+
 	self->size_cb   = rtb_size_hfill;
 	self->layout_cb = rtb_layout_vpack_top;
 
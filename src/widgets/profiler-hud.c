@@ -0,0 +1,342 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/window.h>
+#include <rutabaga/render.h>
+#include <rutabaga/style.h>
+
+#include <rutabaga/widgets/profiler-hud.h>
+
+#define SELF_FROM(elem) \
+	struct rtb_profiler_hud *self = RTB_ELEMENT_AS(elem, rtb_profiler_hud)
+
+#define HISTORY      RTB_PROFILER_HISTORY
+#define BAR_WIDTH    2.f
+#define GRAPH_HEIGHT 64.f
+
+/* offsets into self->graph */
+#define BUDGET_LINE  (HISTORY * 2)
+#define GPU_TRACE    (BUDGET_LINE + 2)
+
+#define NS_TO_MS(ns) ((ns) / 1000000.f)
+
+static struct rtb_element_implementation super, profiler_hud_impl;
+static struct rtb_type_class profiler_hud_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.profiler-hud");
+
+/**
+ * readout
+ */
+
+static void
+update_text(struct rtb_profiler_hud *self, struct rtb_profiler *profiler)
+{
+	const struct rtb_profile_frame *frame, *gpu_frame = NULL;
+	rtb_profile_zone_t zone, heaviest = RTB_PROFILE_FRAME;
+	char buf[128];
+	unsigned int i;
+
+	if (!self->tobj || !self->font)
+		return;
+
+	if (!(frame = rtb_profiler_get_frame(profiler, 0)))
+		return;
+
+	for (i = 0; i < HISTORY && !gpu_frame; i++) {
+		gpu_frame = rtb_profiler_get_frame(profiler, i);
+		if (gpu_frame && !gpu_frame->gpu_valid)
+			gpu_frame = NULL;
+	}
+
+	for (zone = 0; zone < RTB_PROFILE_ZONE_COUNT; zone++)
+		if (frame->zones[zone].cpu_ns > frame->zones[heaviest].cpu_ns)
+			heaviest = zone;
+
+	if (gpu_frame)
+		snprintf(buf, sizeof(buf), "cpu %.2fms  gpu %.2fms  %s %.2fms",
+				NS_TO_MS(frame->cpu_ns), NS_TO_MS(gpu_frame->gpu_ns),
+				rtb_profiler_zone_name(heaviest),
+				NS_TO_MS(frame->zones[heaviest].cpu_ns));
+	else
+		snprintf(buf, sizeof(buf), "cpu %.2fms  %s %.2fms",
+				NS_TO_MS(frame->cpu_ns),
+				rtb_profiler_zone_name(heaviest),
+				NS_TO_MS(frame->zones[heaviest].cpu_ns));
+
+	rtb_text_object_update(self->tobj, self->font, buf, 1.f);
+}
+
+static void
+frame_cb(struct rtb_profiler *profiler, void *ctx)
+{
+	struct rtb_profiler_hud *self = ctx;
+
+	/* only ever called on frames that are happening anyway, so keeping
+	 * up to date doesn't keep the window drawing when it's idle. */
+	update_text(self, profiler);
+	rtb_elem_mark_dirty(RTB_ELEMENT(self));
+}
+
+/**
+ * drawing
+ */
+
+static float
+to_height(struct rtb_profiler_hud *self, uint64_t ns)
+{
+	return fminf(NS_TO_MS(ns) / self->scale_ms, 1.f) * GRAPH_HEIGHT;
+}
+
+static void
+build_graph(struct rtb_profiler_hud *self, int *nbars, int *ngpu)
+{
+	struct rtb_profiler *profiler = &self->window->local_storage.profiler;
+	const struct rtb_profile_frame *frame;
+	GLfloat (*v)[2] = self->graph;
+	float x, bottom;
+	int i;
+
+	bottom = self->y2;
+	*nbars = *ngpu = 0;
+
+	/* newest frame on the right. */
+	for (i = 0; i < HISTORY; i++) {
+		if (!(frame = rtb_profiler_get_frame(profiler, i)))
+			break;
+
+		x = self->x2 - ((i + .5f) * BAR_WIDTH);
+
+		v[*nbars * 2][0] = x;
+		v[*nbars * 2][1] = bottom;
+		v[*nbars * 2 + 1][0] = x;
+		v[*nbars * 2 + 1][1] = bottom - to_height(self, frame->cpu_ns);
+		(*nbars)++;
+
+		if (frame->gpu_valid) {
+			v[GPU_TRACE + *ngpu][0] = x;
+			v[GPU_TRACE + *ngpu][1] = bottom - to_height(self, frame->gpu_ns);
+			(*ngpu)++;
+		}
+	}
+
+	v[BUDGET_LINE][0] = self->x2 - (HISTORY * BAR_WIDTH);
+	v[BUDGET_LINE][1] = bottom
+		- fminf(self->budget_ms / self->scale_ms, 1.f) * GRAPH_HEIGHT;
+	v[BUDGET_LINE + 1][0] = self->x2;
+	v[BUDGET_LINE + 1][1] = v[BUDGET_LINE][1];
+}
+
+static void
+draw_graph(struct rtb_profiler_hud *self)
+{
+	struct rtb_render_context *ctx;
+	GLintptr offset;
+	int nbars, ngpu;
+
+	build_graph(self, &nbars, &ngpu);
+
+	rtb_render_reset(RTB_ELEMENT(self));
+	ctx = rtb_render_get_context(RTB_ELEMENT(self));
+	rtb_render_set_position(ctx, 0, 0);
+
+	glBindVertexArray(self->window->vao);
+
+	offset = rtb_stream_buffer_upload(&self->window->local_storage.stream,
+			self->graph, sizeof(self->graph));
+	if (offset < 0)
+		return;
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0,
+			(const GLvoid *) offset);
+
+	glLineWidth(1.f);
+
+	rtb_render_set_color(ctx,
+			self->color->r, self->color->g, self->color->b, .6f);
+	glDrawArrays(GL_LINES, 0, nbars * 2);
+
+	rtb_render_set_color(ctx, 1.f, 1.f, 1.f, .25f);
+	glDrawArrays(GL_LINES, BUDGET_LINE, 2);
+
+	if (ngpu > 1) {
+		rtb_render_set_color(ctx, 1.f, .6f, .2f, 1.f);
+		glDrawArrays(GL_LINE_STRIP, GPU_TRACE, ngpu);
+	}
+}
+
+static void
+draw(struct rtb_element *elem)
+{
+	SELF_FROM(elem);
+	struct rtb_render_context *ctx = rtb_render_get_context(elem);
+
+	super.draw(elem);
+
+	if (self->tobj)
+		rtb_text_object_render(self->tobj, ctx,
+				self->x, self->y, self->color);
+
+	draw_graph(self);
+}
+
+/**
+ * element implementation
+ */
+
+static void
+attached(struct rtb_element *elem,
+		struct rtb_element *parent, struct rtb_window *window)
+{
+	SELF_FROM(elem);
+	struct rtb_profiler *profiler = &window->local_storage.profiler;
+
+	super.attached(elem, parent, window);
+	self->type = rtb_type_ref_class(window, self->type,
+			&profiler_hud_type);
+
+	self->tobj = rtb_text_object_new(&window->font_manager);
+
+	profiler->frame_cb = frame_cb;
+	profiler->frame_ctx = self;
+	rtb_profiler_enable(profiler, 1);
+}
+
+static void
+detached(struct rtb_element *elem,
+		struct rtb_element *parent, struct rtb_window *window)
+{
+	SELF_FROM(elem);
+	struct rtb_profiler *profiler = &window->local_storage.profiler;
+
+	/* no one left to show the timings to, so stop paying for them. */
+	if (profiler->frame_ctx == self) {
+		profiler->frame_cb = NULL;
+		profiler->frame_ctx = NULL;
+		rtb_profiler_enable(profiler, 0);
+	}
+
+	rtb_text_object_free(self->tobj);
+	self->tobj = NULL;
+
+	super.detached(elem, parent, window);
+}
+
+static void
+size(struct rtb_element *elem,
+		const struct rtb_size *avail, struct rtb_size *want)
+{
+	SELF_FROM(elem);
+
+	want->w = HISTORY * BAR_WIDTH;
+	want->h = GRAPH_HEIGHT;
+
+	if (self->font)
+		want->h += ceilf(self->font->txfont->height);
+}
+
+static void
+restyle(struct rtb_element *elem)
+{
+	const struct rtb_style_property_definition *prop;
+
+	SELF_FROM(elem);
+
+	super.restyle(elem);
+
+	prop = rtb_style_query_prop_in_tree(self->parent,
+			"font", RTB_STYLE_PROP_FONT, 0);
+
+	assert(prop);
+
+	self->font = rtb_style_get_font_for_def(self->window, &prop->font);
+
+	prop = rtb_style_query_prop_in_tree(RTB_ELEMENT(self),
+			"color", RTB_STYLE_PROP_COLOR, 1);
+	self->color = &prop->color;
+}
+
+/**
+ * public
+ */
+
+int
+rtb_profiler_hud_init(struct rtb_profiler_hud *self)
+{
+	if (RTB_SUBCLASS(RTB_ELEMENT(self), rtb_elem_init, &super))
+		return -1;
+
+	if (!profiler_hud_impl.draw) {
+		profiler_hud_impl = super;
+		profiler_hud_impl.draw     = draw;
+		profiler_hud_impl.attached = attached;
+		profiler_hud_impl.detached = detached;
+		profiler_hud_impl.restyle  = restyle;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &profiler_hud_impl);
+
+	self->size_cb = size;
+
+	self->font = NULL;
+	self->tobj = NULL;
+
+	self->scale_ms  = 1000.f / 30.f;
+	self->budget_ms = 1000.f / 60.f;
+
+	return 0;
+}
+
+void
+rtb_profiler_hud_fini(struct rtb_profiler_hud *self)
+{
+	if (self->tobj)
+		rtb_text_object_free(self->tobj);
+
+	rtb_elem_fini(RTB_ELEMENT(self));
+}
+
+struct rtb_profiler_hud *
+rtb_profiler_hud_new(void)
+{
+	struct rtb_profiler_hud *self = calloc(1, sizeof(*self));
+	rtb_profiler_hud_init(self);
+	return self;
+}
+
+void
+rtb_profiler_hud_free(struct rtb_profiler_hud *self)
+{
+	rtb_profiler_hud_fini(self);
+	free(self);
+}
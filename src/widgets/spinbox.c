@@ -43,7 +43,9 @@
 #define SELF_FROM(elem) \
 	struct rtb_spinbox *self = RTB_ELEMENT_AS(elem, rtb_spinbox)
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, spinbox_impl;
+static struct rtb_type_class spinbox_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.spinbox");
 
 /**
  * internal API hooks
@@ -66,8 +68,8 @@ attached(struct rtb_element *elem,
 	SELF_FROM(elem);
 
 	super.attached(elem, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.widgets.spinbox");
+	self->type = rtb_type_ref_class(window, self->type,
+			&spinbox_type);
 
 	set_value_hook(elem, 1);
 }
@@ -82,7 +84,12 @@ rtb_spinbox_init(struct rtb_spinbox *self)
 	if (RTB_SUBCLASS(RTB_VALUE_ELEMENT(self), rtb_value_element_init, &super))
 		return -1;
 
-	self->attached = attached;
+	if (!spinbox_impl.draw) {
+		spinbox_impl = super;
+		spinbox_impl.attached = attached;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &spinbox_impl);
 
 	self->size_cb   = rtb_size_hfit_children;
 	self->layout_cb = rtb_layout_hpack_center;
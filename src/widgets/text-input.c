@@ -45,7 +45,9 @@
 
 #define UTF8_IS_CONTINUATION(byte) (((byte) & 0xC0) == 0x80)
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, text_input_impl;
+static struct rtb_type_class text_input_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.widgets.text-input");
 
 /**
  * vbo wrangling
@@ -54,7 +56,7 @@ static struct rtb_element_implementation super;
 static void
 update_cursor(struct rtb_text_input *self)
 {
-	GLfloat x, y, h, line[2][2];
+	GLfloat x, y, h;
 	struct rtb_rect glyphs[2];
 
 	if (self->cursor_position > 0) {
@@ -101,15 +103,11 @@ update_cursor(struct rtb_text_input *self)
 	y  = self->label.y;
 	h  = self->label.h;
 
-	line[0][0] = x;
-	line[0][1] = y;
+	self->cursor_line[0][0] = x;
+	self->cursor_line[0][1] = y;
 
-	line[1][0] = x;
-	line[1][1] = y + h;
-
-	glBindBuffer(GL_ARRAY_BUFFER, self->cursor_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(line), line, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	self->cursor_line[1][0] = x;
+	self->cursor_line[1][1] = y + h;
 }
 
 /**
@@ -120,14 +118,22 @@ static void
 draw_cursor(struct rtb_text_input *self)
 {
 	struct rtb_render_context *ctx;
+	GLintptr offset;
 
 	rtb_render_reset(RTB_ELEMENT(self));
 	ctx = rtb_render_get_context(RTB_ELEMENT(self));
 	rtb_render_set_position(ctx, 0, 0);
 
-	glBindBuffer(GL_ARRAY_BUFFER, self->cursor_vbo);
+	glBindVertexArray(self->window->vao);
+
+	offset = rtb_stream_buffer_upload(&self->window->local_storage.stream,
+			self->cursor_line, sizeof(self->cursor_line));
+	if (offset < 0)
+		return;
+
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0,
+			(const GLvoid *) offset);
 
 	glLineWidth(1.f);
 
@@ -309,8 +315,8 @@ attached(struct rtb_element *elem,
 	SELF_FROM(elem);
 
 	super.attached(elem, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.widgets.text-input");
+	self->type = rtb_type_ref_class(window, self->type,
+			&text_input_type);
 }
 
 static void
@@ -387,7 +393,7 @@ rtb_text_input_init(struct rutabaga *rtb, struct rtb_text_input *self)
 
 	rtb_text_buffer_init(rtb, &self->text);
 
-	glGenBuffers(1, &self->cursor_vbo);
+	memset(self->cursor_line, 0, sizeof(self->cursor_line));
 
 	self->label.align = RTB_ALIGN_MIDDLE;
 	self->label_offset = 0;
@@ -395,11 +401,17 @@ rtb_text_input_init(struct rutabaga *rtb, struct rtb_text_input *self)
 	self->outer_pad.x =
 		self->outer_pad.y = 0.f;
 
-	self->draw      = draw;
-	self->on_event  = on_event;
-	self->attached  = attached;
-	self->reflow    = reflow;
-	self->restyle   = restyle;
+	if (!text_input_impl.draw) {
+		text_input_impl = super;
+		text_input_impl.draw     = draw;
+		text_input_impl.on_event = on_event;
+		text_input_impl.attached = attached;
+		text_input_impl.reflow   = reflow;
+		text_input_impl.restyle  = restyle;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &text_input_impl);
+
 	self->size_cb   = rtb_size_self;
 	self->layout_cb = layout;
 
@@ -417,7 +429,6 @@ rtb_text_input_fini(struct rtb_text_input *self)
 	rtb_text_buffer_fini(&self->text);
 
 	rtb_quad_fini(&self->bg_quad);
-	glDeleteBuffers(1, &self->cursor_vbo);
 
 	rtb_label_fini(&self->label);
 	rtb_elem_fini(RTB_ELEMENT(self));
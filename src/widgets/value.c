@@ -42,7 +42,7 @@
 #define SELF_FROM(elem) \
 	struct rtb_value_element *self = RTB_ELEMENT_AS(elem, rtb_value_element)
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, value_impl;
 
 /* would be cool to have this be like a smoothed equation or smth */
 #define DELTA_VALUE_STEP_COARSE	.005f
@@ -427,8 +427,13 @@ rtb_value_element_init(struct rtb_value_element *self)
 	if (RTB_SUBCLASS(RTB_ELEMENT(self), rtb_elem_init, &super))
 		return -1;
 
-	self->attached = attached;
-	self->on_event = on_event;
+	if (!value_impl.draw) {
+		value_impl = super;
+		value_impl.attached = attached;
+		value_impl.on_event = on_event;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &value_impl);
 
 	self->granularity  =
 		self->value    =
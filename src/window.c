@@ -26,6 +26,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
 
 #include <rutabaga/rutabaga.h>
@@ -39,19 +40,24 @@
 #include <rutabaga/surface.h>
 #include <rutabaga/style.h>
 #include <rutabaga/mat4.h>
+#include <rutabaga/platform.h>
 
 #include "rtb_private/util.h"
 #include "rtb_private/window_impl.h"
+#include "rtb_private/stdlib-allocator.h"
 
 #include "shaders/default.glsl.h"
 #include "shaders/surface.glsl.h"
 #include "shaders/stylequad.glsl.h"
+#include "shaders/stylequad-batch.glsl.h"
 
 #define ERR(...) fprintf(stderr, "rutabaga: " __VA_ARGS__)
 #define SELF_FROM(elem) \
 	struct rtb_window *self = RTB_ELEMENT_AS(elem, rtb_window)
 
-static struct rtb_element_implementation super;
+static struct rtb_element_implementation super, window_impl;
+static struct rtb_type_class window_type =
+	RTB_TYPE_CLASS("net.illest.rutabaga.window");
 
 /**
  * index buffer objects
@@ -190,8 +196,15 @@ shaders_init(struct rtb_window *self)
 				STYLEQUAD_VERT_SHADER, NULL, STYLEQUAD_FRAG_SHADER))
 		goto err_stylequad;
 
+	if (!rtb_shader_create(&self->local_storage.shader.stylequad_batch,
+				STYLEQUAD_BATCH_VERT_SHADER, NULL,
+				STYLEQUAD_BATCH_FRAG_SHADER))
+		goto err_stylequad_batch;
+
 	return 0;
 
+err_stylequad_batch:
+	rtb_shader_free(&self->local_storage.shader.stylequad);
 err_stylequad:
 	rtb_shader_free(&self->local_storage.shader.surface);
 err_surface:
@@ -203,6 +216,7 @@ err_dfault:
 static void
 shaders_fini(struct rtb_window *self)
 {
+	rtb_shader_free(&self->local_storage.shader.stylequad_batch);
 	rtb_shader_free(&self->local_storage.shader.stylequad);
 	rtb_shader_free(&self->local_storage.shader.surface);
 	rtb_shader_free(&self->local_storage.shader.dfault);
@@ -244,18 +258,182 @@ attached(struct rtb_element *elem,
 	SELF_FROM(elem);
 
 	super.attached(elem, parent, window);
-	self->type = rtb_type_ref(window, self->type,
-			"net.illest.rutabaga.window");
+	self->type = rtb_type_ref_class(window, self->type,
+			&window_type);
 
 	rtb_style_resolve_list(self, self->style_list);
-	self->restyle(RTB_ELEMENT(self));
+
+	rtb_elem_invalidate_style(RTB_ELEMENT(self), RTB_RESTYLE_TREE);
+	rtb_elem_restyle_pending(RTB_ELEMENT(self));
 }
 
 static void
 mark_dirty(struct rtb_element *elem)
 {
 	SELF_FROM(elem);
+
+	if (self->dirty)
+		return;
+
 	self->dirty = 1;
+	rtb__platform_request_frame(self);
+}
+
+/**
+ * frame scheduling
+ */
+
+static int
+has_frame_handler(struct rtb_window *self)
+{
+	size_t i;
+
+	for (i = 0; i < self->handlers.size; i++) {
+		switch (self->handlers.data[i].type) {
+		case RTB_FRAME_START:
+		case RTB_FRAME_END:
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void
+run_frame_callbacks(struct rtb_window *self, uint64_t frame_time)
+{
+	struct rtb_frame_callbacks swap;
+	size_t i;
+
+	if (!self->frame_callbacks.pending.size)
+		return;
+
+	/* callbacks requested from in here are for the next frame. */
+	swap = self->frame_callbacks.running;
+	self->frame_callbacks.running = self->frame_callbacks.pending;
+	self->frame_callbacks.pending = swap;
+
+	for (i = 0; i < self->frame_callbacks.running.size; i++)
+		self->frame_callbacks.running.data[i].cb(self, frame_time,
+				self->frame_callbacks.running.data[i].ctx);
+
+	VECTOR_CLEAR(&self->frame_callbacks.running);
+}
+
+int
+rtb_window_wants_frame(struct rtb_window *self)
+{
+	if (!rtb_mutation_queue_is_empty(&self->mutations))
+		return 1;
+
+	if (self->state == RTB_STATE_UNATTACHED
+			|| self->visibility == RTB_FULLY_OBSCURED)
+		return 0;
+
+	return self->dirty
+		|| self->restyle_pending
+		|| self->frame_callbacks.pending.size
+		|| has_frame_handler(self);
+}
+
+void
+rtb_window_request_frame(struct rtb_window *self,
+		rtb_frame_cb_t cb, void *ctx)
+{
+	struct rtb_frame_callback callback = {
+		.cb  = cb,
+		.ctx = ctx
+	};
+
+	VECTOR_PUSH_BACK(&self->frame_callbacks.pending, &callback);
+
+	if (self->frame_callbacks.pending.size == 1 && !self->dirty)
+		rtb__platform_request_frame(self);
+}
+
+void
+rtb_window_cancel_frame(struct rtb_window *self,
+		rtb_frame_cb_t cb, void *ctx)
+{
+	struct rtb_frame_callbacks *pending = &self->frame_callbacks.pending;
+	size_t i;
+
+	for (i = pending->size; i > 0; i--)
+		if (pending->data[i - 1].cb == cb && pending->data[i - 1].ctx == ctx)
+			VECTOR_ERASE(pending, i - 1);
+}
+
+/**
+ * presentation
+ */
+
+static void
+repair_back_buffer(struct rtb_window *self, const struct rtb_rgb_color *bg)
+{
+	struct rtb_render_state *state = &self->local_storage.state;
+	struct rtb_surface *surface = RTB_SURFACE(self);
+	struct rtb_rect stale = {.x = 0.f};
+	int age, i;
+
+	/* elements get cleared straight onto the window background now. */
+	surface->render_ctx.clear_color[0] = bg->r;
+	surface->render_ctx.clear_color[1] = bg->g;
+	surface->render_ctx.clear_color[2] = bg->b;
+	surface->render_ctx.clear_color[3] = bg->a;
+
+	if (surface->surface_state == RTB_SURFACE_INVALID)
+		return;
+
+	age = (self->present.mode == RTB_PRESENT_COPY_SUB_BUFFER)
+		? 1 : self->present.buffer_age;
+
+	/* no idea what's in there, so we start from scratch. */
+	if (age < 1 || age > RTB_WINDOW_DAMAGE_HISTORY + 1) {
+		rtb_surface_invalidate(surface);
+		return;
+	}
+
+	/* the back buffer is `age` frames old, so it's missing whatever
+	 * changed in the frames drawn since. */
+	for (i = 0; i < age - 1; i++)
+		rtb_rect_union(&stale, &self->present.history[i]);
+
+	if (rtb_rect_is_empty(&stale))
+		return;
+
+	/* redrawing children doesn't cover the gaps between them, so when
+	 * we're not repainting by damage the background has to go first. */
+	if (surface->repaint_mode == RTB_SURFACE_REPAINT_SUBTREE) {
+		rtb_render_state_scissor(state,
+				stale.x, self->h - stale.y2, stale.w, stale.h);
+
+		glClearColor(bg->r, bg->g, bg->b, bg->a);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	rtb_surface_add_damage(surface, &stale);
+}
+
+static void
+record_damage(struct rtb_window *self)
+{
+	struct rtb_rect *damage = &self->present.damage;
+	struct rtb_rect *history = self->present.history;
+
+	if (self->present.mode == RTB_PRESENT_FULL || self->present.exposed) {
+		damage->x = 0.f;
+		damage->y = 0.f;
+		damage->w = self->w;
+		damage->h = self->h;
+		rtb_rect_update_points_from_size(damage);
+	} else
+		*damage = RTB_SURFACE(self)->damage;
+
+	memmove(&history[1], &history[0],
+			sizeof(*history) * (RTB_WINDOW_DAMAGE_HISTORY - 1));
+	history[0] = RTB_SURFACE(self)->damage;
+
+	self->present.exposed = 0;
 }
 
 /**
@@ -285,48 +463,96 @@ int
 rtb_window_draw(struct rtb_window *self, int force_redraw)
 {
 	const struct rtb_style_property_definition *prop;
+	struct rtb_render_state *state = &self->local_storage.state;
 	struct rtb_window_event ev;
+#ifdef _RTB_DEBUG_FRAME
+	uint64_t frame_start;
+#endif
+
+	/* even if we don't end up drawing, so that the queue doesn't grow
+	 * without bound while we're hidden. */
+	rtb_mutation_queue_drain(&self->mutations, self);
 
 	if (self->state == RTB_STATE_UNATTACHED
 			|| self->visibility == RTB_FULLY_OBSCURED)
 		return 0;
 
+	run_frame_callbacks(self, self->present.frame_time
+			? self->present.frame_time : uv_hrtime());
+
 	ev.type = RTB_FRAME_START;
 	ev.source = RTB_EVENT_GENUINE;
 	ev.window = self;
 	rtb_dispatch_raw(RTB_ELEMENT(self), RTB_EVENT(&ev));
 
+	/* whatever the state changes since the last frame left marked.
+	 * this is what usually makes us dirty. */
+	rtb_elem_restyle_pending(RTB_ELEMENT(self));
+
 	if (!self->dirty || force_redraw)
 		return 0;
 
-	glViewport(0, 0, self->w, self->h);
+	/* FRAME_START handlers are free to do whatever they like to the GL
+	 * state, so this is where we stop trusting what we had cached. */
+	rtb_render_state_begin_frame(state);
+	rtb_profiler_begin_frame(&self->local_storage.profiler);
+
+#ifdef _RTB_DEBUG_FRAME
+	frame_start = uv_hrtime();
+#endif
 
-	prop = rtb_style_query_prop(RTB_ELEMENT(self),
-			"background-color", RTB_STYLE_PROP_COLOR, 1);
+	rtb_render_state_bind_framebuffer(state, self->present.framebuffer);
+	rtb_render_state_viewport(state, 0, 0, self->w, self->h);
+
+	prop = rtb_style_query_prop_id(RTB_ELEMENT(self),
+			RTB_STYLE_PROP_ID_BACKGROUND_COLOR, RTB_STYLE_PROP_COLOR, 1);
 
 	glEnable(GL_DITHER);
 	glEnable(GL_BLEND);
-	glEnable(GL_SCISSOR_TEST);
-
-	glClearColor(
-			prop->color.r,
-			prop->color.g,
-			prop->color.b,
-			prop->color.a);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	rtb_render_state_scissor_test(state, 1);
+
+	if (self->present.mode == RTB_PRESENT_FULL) {
+		glClearColor(
+				prop->color.r,
+				prop->color.g,
+				prop->color.b,
+				prop->color.a);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	} else
+		repair_back_buffer(self, &prop->color);
 
 	rtb_render_push(RTB_ELEMENT(self));
-	self->draw(RTB_ELEMENT(self));
+	RTB_IMPL(self)->draw(RTB_ELEMENT(self));
 	rtb_render_pop(RTB_ELEMENT(self));
 
+	record_damage(self);
 	self->dirty = 0;
 
+	rtb_profiler_end_frame(&self->local_storage.profiler);
+
+#ifdef _RTB_DEBUG_FRAME
+	/* this is CPU time spent submitting, the GPU may well still be
+	 * busy with the frame. */
+	printf(" :: frame: %.3fms CPU, %u GL state changes issued, %u elided, "
+			"%lu pixels and %u elements repainted\n",
+			(uv_hrtime() - frame_start) / 1000000.,
+			state->stats.issued, state->stats.elided,
+			state->stats.repainted_pixels, state->stats.repainted_elements);
+#endif
+
 	ev.type = RTB_FRAME_END;
 	rtb_dispatch_raw(RTB_ELEMENT(self), RTB_EVENT(&ev));
 
 	return 1;
 }
 
+void
+rtb_window_mark_exposed(struct rtb_window *self)
+{
+	self->present.exposed = 1;
+	rtb_elem_mark_dirty(RTB_ELEMENT(self));
+}
+
 void
 rtb_window_reinit(struct rtb_window *self)
 {
@@ -336,10 +562,11 @@ rtb_window_reinit(struct rtb_window *self)
 
 	self->x = self->y = 0.f;
 
-	glScissor(0, 0, self->w, self->h);
+	rtb_render_state_scissor(&self->local_storage.state,
+			0, 0, self->w, self->h);
 
 	if (!self->window)
-		self->attached(elem, NULL, self);
+		RTB_IMPL(self)->attached(elem, NULL, self);
 
 	self->finished_initialising = 1;
 	rtb_elem_trigger_reflow(elem, elem, RTB_DIRECTION_LEAFWARD);
@@ -379,10 +606,17 @@ rtb_window_open_under(struct rutabaga *r, intptr_t parent,
 		goto err_window_impl;
 
 	init_gl();
+	rtb_render_state_invalidate(&self->local_storage.state);
 
 	if (RTB_SUBCLASS(RTB_SURFACE(self), rtb_surface_init, &super))
 		goto err_surface_init;
 
+	/* if the platform can keep track of what's in the back buffer, we
+	 * can draw into it directly and skip the round trip through an
+	 * offscreen surface. */
+	RTB_SURFACE(self)->draw_in_place =
+		(self->present.mode != RTB_PRESENT_FULL);
+
 	self->w = w;
 	self->h = h;
 
@@ -398,19 +632,45 @@ rtb_window_open_under(struct rutabaga *r, intptr_t parent,
 	if (ibos_init(self))
 		goto err_ibos;
 
+	if (rtb_texture_cache_init(&self->local_storage.textures))
+		goto err_textures;
+
+	if (rtb_render_target_pool_init(&self->local_storage.targets))
+		goto err_targets;
+
+	if (rtb_stream_buffer_init(&self->local_storage.stream))
+		goto err_stream;
+
+	if (rtb_profiler_init(&self->local_storage.profiler))
+		goto err_profiler;
+
 	if (rtb_font_manager_init(&self->font_manager,
 				self->dpi.x, self->dpi.y))
 		goto err_font;
 
+	if (rtb_style_prop_table_init(&self->style_props))
+		goto err_style_props;
+
+	VECTOR_INIT(&self->frame_callbacks.pending, &stdlib_allocator, 8);
+	VECTOR_INIT(&self->frame_callbacks.running, &stdlib_allocator, 8);
+	rtb_mutation_queue_init(&self->mutations);
+
 	rtb_elem_set_layout(RTB_ELEMENT(self), rtb_layout_vpack_top);
 
-	self->on_event   = win_event;
-	self->mark_dirty = mark_dirty;
-	self->attached   = attached;
+	if (!window_impl.draw) {
+		window_impl = super;
+		window_impl.on_event   = win_event;
+		window_impl.mark_dirty = mark_dirty;
+		window_impl.attached   = attached;
+	}
+
+	rtb_elem_set_impl(RTB_ELEMENT(self), &window_impl);
 
 	self->flags = RTB_ELEM_CLICK_FOCUS;
 
-	/* for core profiles */
+	/* core profiles won't draw without a vertex array bound. quads,
+	 * stylequads and text bring their own, this one is shared by the
+	 * odds and ends that stream their vertices. */
 	glGenVertexArrays(1, &self->vao);
 	glBindVertexArray(self->vao);
 
@@ -421,7 +681,17 @@ rtb_window_open_under(struct rutabaga *r, intptr_t parent,
 
 	return self;
 
+err_style_props:
+	rtb_font_manager_fini(&self->font_manager);
 err_font:
+	rtb_profiler_fini(&self->local_storage.profiler);
+err_profiler:
+	rtb_stream_buffer_fini(&self->local_storage.stream);
+err_stream:
+	rtb_render_target_pool_fini(&self->local_storage.targets);
+err_targets:
+	rtb_texture_cache_fini(&self->local_storage.textures);
+err_textures:
 	ibos_fini(self);
 err_ibos:
 	shaders_fini(self);
@@ -449,12 +719,26 @@ rtb_window_close(struct rtb_window *self)
 
 	rtb_font_manager_fini(&self->font_manager);
 
+	VECTOR_FREE(&self->frame_callbacks.pending);
+	VECTOR_FREE(&self->frame_callbacks.running);
+	rtb_mutation_queue_fini(&self->mutations);
+
 	ibos_fini(self);
 	shaders_fini(self);
 
+	rtb_style_unresolve_list(self->style_list);
+	rtb_style_prop_table_fini(&self->style_props);
 	free(self->style_fonts);
 	free(self->style_list);
 
 	rtb_surface_fini(RTB_SURFACE(self));
+
+	/* after the surface, since our own stylequad holds references and
+	 * our render target goes back to the pool. */
+	rtb_render_target_pool_fini(&self->local_storage.targets);
+	rtb_texture_cache_fini(&self->local_storage.textures);
+	rtb_stream_buffer_fini(&self->local_storage.stream);
+	rtb_profiler_fini(&self->local_storage.profiler);
+
 	window_impl_close(self);
 }
@@ -0,0 +1,135 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * the texture cache keys entries by their definition, so one definition
+ * asked for with different flags ends up as several entries sharing a
+ * key. asking again for any of them has to find the one already there
+ * rather than uploading another copy.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/style.h>
+#include <rutabaga/texture-cache.h>
+
+#define TEX_SIZE 16
+
+static unsigned char pixels[TEX_SIZE * TEX_SIZE * 4];
+static int failures;
+
+#define CHECK(cond) do {                                              \
+	if (!(cond)) {                                                    \
+		fprintf(stderr, "%s:%d: check failed: %s\n",                  \
+				__FILE__, __LINE__, #cond);                           \
+		failures++;                                                   \
+	}                                                                 \
+} while (0)
+
+static void
+init_definition(struct rtb_style_texture_definition *def)
+{
+	memset(def, 0, sizeof(*def));
+	memset(pixels, 0xFF, sizeof(pixels));
+
+	RTB_ASSET(def)->location = RTB_ASSET_EMBEDDED;
+	RTB_ASSET(def)->loaded = 1;
+	RTB_ASSET(def)->buffer.size = sizeof(pixels);
+	RTB_ASSET(def)->buffer.data = pixels;
+
+	def->w = TEX_SIZE;
+	def->h = TEX_SIZE;
+}
+
+static void
+test_ref_with_two_flag_sets(void)
+{
+	const rtb_texture_cache_flags_t tiled =
+		RTB_TEXTURE_CACHE_NEAREST | RTB_TEXTURE_CACHE_REPEAT;
+
+	struct rtb_cached_texture *atlas, *standalone;
+	struct rtb_cached_texture *atlas_again, *standalone_again;
+	struct rtb_style_texture_definition def;
+	struct rtb_texture_cache cache;
+
+	init_definition(&def);
+	CHECK(!rtb_texture_cache_init(&cache));
+
+	atlas = rtb_texture_cache_ref(&cache, &def, RTB_TEXTURE_CACHE_ATLAS);
+	standalone = rtb_texture_cache_ref(&cache, &def, tiled);
+
+	CHECK(atlas && standalone);
+	CHECK(atlas != standalone);
+
+	/* the first entry for the key is the one that used to get lost. */
+	atlas_again =
+		rtb_texture_cache_ref(&cache, &def, RTB_TEXTURE_CACHE_ATLAS);
+	CHECK(atlas_again == atlas);
+	CHECK(atlas->refcount == 2);
+
+	standalone_again = rtb_texture_cache_ref(&cache, &def, tiled);
+	CHECK(standalone_again == standalone);
+	CHECK(standalone->refcount == 2);
+
+	rtb_texture_cache_unref(atlas_again);
+	rtb_texture_cache_unref(atlas);
+	rtb_texture_cache_unref(standalone_again);
+	rtb_texture_cache_unref(standalone);
+
+	rtb_texture_cache_fini(&cache);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct rtb_window *win;
+	struct rutabaga *rtb;
+
+	/* for the GL context. */
+	if (!(rtb = rtb_new()))
+		return EXIT_FAILURE;
+
+	if (!(win = rtb_window_open(rtb, 64, 64, "texture-cache test")))
+		return EXIT_FAILURE;
+
+	/* held through rtb_window_close(), like the examples do. */
+	rtb_window_lock(win);
+	test_ref_with_two_flag_sets();
+
+	rtb_window_close(win);
+	rtb_free(rtb);
+
+	if (failures) {
+		fprintf(stderr, "texture-cache: %d check(s) failed\n", failures);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
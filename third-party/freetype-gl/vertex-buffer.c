@@ -154,6 +154,8 @@ vertex_buffer_new( const char *format )
     self->indices_id  = 0;
     self->GPU_isize = 0;
 
+    self->VAO_id = 0;
+
     self->items = vector_new( sizeof(ivec4) );
     self->state = DIRTY;
     self->mode = GL_TRIANGLES;
@@ -196,6 +198,12 @@ vertex_buffer_delete( vertex_buffer_t *self )
     }
     self->indices_id = 0;
 
+    if( self->VAO_id )
+    {
+        glDeleteVertexArrays( 1, &self->VAO_id );
+    }
+    self->VAO_id = 0;
+
     vector_delete( self->items );
 
     if( self->format )
@@ -275,10 +283,26 @@ vertex_buffer_print( vertex_buffer_t * self )
 }
 
 
+// ----------------------------------------------------------------------------
+static size_t
+grow_capacity( size_t capacity, size_t needed )
+{
+    capacity = capacity ? capacity : 256;
+    while( capacity < needed )
+    {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+
+
 // ----------------------------------------------------------------------------
 void
 vertex_buffer_upload ( vertex_buffer_t *self )
 {
+    int build_vao = 0;
+
     if( self->state == FROZEN )
     {
         return;
@@ -292,43 +316,62 @@ vertex_buffer_upload ( vertex_buffer_t *self )
     {
         glGenBuffers( 1, &self->indices_id );
     }
+    if( !self->VAO_id )
+    {
+        glGenVertexArrays( 1, &self->VAO_id );
+        build_vao = 1;
+    }
 
     size_t vsize = self->vertices->size*self->vertices->item_size;
     size_t isize = self->indices->size*self->indices->item_size;
 
+    // The index buffer binding is part of the VAO's state, so it has to be
+    // bound while we touch it.
+    glBindVertexArray( self->VAO_id );
 
     // Always upload vertices first such that indices do not point to non
     // existing data (if we get interrupted in between for example).
 
     // Upload vertices
+    // The GPU buffers only ever grow, and then geometrically, so that text
+    // changing length a glyph at a time doesn't reallocate them each time.
     glBindBuffer( GL_ARRAY_BUFFER, self->vertices_id );
-    if( vsize != self->GPU_vsize )
+    if( vsize > self->GPU_vsize )
     {
+        self->GPU_vsize = grow_capacity( self->GPU_vsize, vsize );
         glBufferData( GL_ARRAY_BUFFER,
-                      vsize, self->vertices->items, GL_DYNAMIC_DRAW );
-        self->GPU_vsize = vsize;
+                      self->GPU_vsize, NULL, GL_DYNAMIC_DRAW );
     }
-    else
+    glBufferSubData( GL_ARRAY_BUFFER,
+                     0, vsize, self->vertices->items );
+
+    // The buffers never change identity, so the attribute layout only has
+    // to be recorded once.
+    if( build_vao )
     {
-        glBufferSubData( GL_ARRAY_BUFFER,
-                         0, vsize, self->vertices->items );
+        size_t i;
+        for( i=0; i<MAX_VERTEX_ATTRIBUTE; ++i )
+        {
+            if( self->attributes[i] )
+            {
+                vertex_attribute_enable( self->attributes[i] );
+            }
+        }
     }
     glBindBuffer( GL_ARRAY_BUFFER, 0 );
 
     // Upload indices
     glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, self->indices_id );
-    if( isize != self->GPU_isize )
+    if( isize > self->GPU_isize )
     {
+        self->GPU_isize = grow_capacity( self->GPU_isize, isize );
         glBufferData( GL_ELEMENT_ARRAY_BUFFER,
-                      isize, self->indices->items, GL_DYNAMIC_DRAW );
-        self->GPU_isize = isize;
+                      self->GPU_isize, NULL, GL_DYNAMIC_DRAW );
     }
-    else
-    {
-        glBufferSubData( GL_ELEMENT_ARRAY_BUFFER,
-                         0, isize, self->indices->items );
-    }
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+    glBufferSubData( GL_ELEMENT_ARRAY_BUFFER,
+                     0, isize, self->indices->items );
+
+    glBindVertexArray( 0 );
 }
 
 
@@ -357,27 +400,9 @@ vertex_buffer_render_setup ( vertex_buffer_t *self, GLenum mode )
         vertex_buffer_upload( self );
         self->state = CLEAN;
     }
-    
-    glBindBuffer( GL_ARRAY_BUFFER, self->vertices_id );
 
-    size_t i;
-    for( i=0; i<MAX_VERTEX_ATTRIBUTE; ++i )
-    {
-        vertex_attribute_t *attribute = self->attributes[i];
-        if ( attribute == 0 )
-        {
-            continue;
-        }
-        else
-        {
-            vertex_attribute_enable( attribute );
-        }
-    }
-
-    if( self->indices->size )
-    {
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, self->indices_id );
-    }
+    // Everything, index buffer included, was captured by the VAO.
+    glBindVertexArray( self->VAO_id );
     self->mode = mode;
 }
 
@@ -385,8 +410,9 @@ vertex_buffer_render_setup ( vertex_buffer_t *self, GLenum mode )
 void
 vertex_buffer_render_finish ( vertex_buffer_t *self )
 {
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+    // Unbinding the index buffer here would detach it from the VAO; whoever
+    // draws next binds their own VAO anyway.
+    (void) self;
 }
 
 
@@ -425,7 +451,6 @@ vertex_buffer_render ( vertex_buffer_t *self, GLenum mode )
     vertex_buffer_render_setup( self, mode );
     if( icount )
     {
-        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, self->indices_id );
         glDrawElements( mode, icount, GL_UNSIGNED_INT, 0 );
     }
     else
@@ -73,10 +73,13 @@ typedef struct
     /** GL identity of the indices buffer. */
     GLuint indices_id;
 
-    /** Current size of the vertices buffer in GPU */
+    /** GL identity of the vertex array object, built on first upload. */
+    GLuint VAO_id;
+
+    /** Allocated size of the vertices buffer in GPU */
     size_t GPU_vsize;
 
-    /** Current size of the indices buffer in GPU*/
+    /** Allocated size of the indices buffer in GPU */
     size_t GPU_isize;
 
     /** GL primitives to render. */
@@ -42,6 +42,13 @@ static PROC WinGetProcAddress(const char *name)
 #define IntGetProcAddress(name) WinGetProcAddress(name)
 #endif
 
+/* headless, where there may well be no GLX to ask */
+#if defined(RTB_EGL)
+#include <EGL/egl.h>
+
+#define IntGetProcAddress(name) eglGetProcAddress(name)
+#endif /* RTB_EGL */
+
 /* Linux, FreeBSD, other */
 #ifndef IntGetProcAddress
 	extern void ( * glXGetProcAddressARB (const GLubyte *procName)) (void);
@@ -49,7 +56,23 @@ static PROC WinGetProcAddress(const char *name)
 	#define IntGetProcAddress(name) (*glXGetProcAddressARB)((const GLubyte*)name)
 #endif
 
-/* TODO: Need to eventually use eglGetProcAddress */
+int ogl_ext_ARB_timer_query = ogl_LOAD_FAILED;
+
+void (CODEGEN_FUNCPTR *_ptrc_glGetQueryObjecti64v)(GLuint, GLenum, GLint64 *) = NULL;
+void (CODEGEN_FUNCPTR *_ptrc_glGetQueryObjectui64v)(GLuint, GLenum, GLuint64 *) = NULL;
+void (CODEGEN_FUNCPTR *_ptrc_glQueryCounter)(GLuint, GLenum) = NULL;
+
+static int Load_ARB_timer_query()
+{
+	int numFailed = 0;
+	_ptrc_glGetQueryObjecti64v = (void (CODEGEN_FUNCPTR *)(GLuint, GLenum, GLint64 *))IntGetProcAddress("glGetQueryObjecti64v");
+	if(!_ptrc_glGetQueryObjecti64v) numFailed++;
+	_ptrc_glGetQueryObjectui64v = (void (CODEGEN_FUNCPTR *)(GLuint, GLenum, GLuint64 *))IntGetProcAddress("glGetQueryObjectui64v");
+	if(!_ptrc_glGetQueryObjectui64v) numFailed++;
+	_ptrc_glQueryCounter = (void (CODEGEN_FUNCPTR *)(GLuint, GLenum))IntGetProcAddress("glQueryCounter");
+	if(!_ptrc_glQueryCounter) numFailed++;
+	return numFailed;
+}
 
 void (CODEGEN_FUNCPTR *_ptrc_glBlendFunc)(GLenum, GLenum) = NULL;
 void (CODEGEN_FUNCPTR *_ptrc_glClear)(GLbitfield) = NULL;
@@ -1025,10 +1048,10 @@ typedef struct ogl_StrToExtMap_s
 } ogl_StrToExtMap;
 
 static ogl_StrToExtMap ExtensionMap[1] = {
-	{"", NULL, NULL},
+	{"GL_ARB_timer_query", &ogl_ext_ARB_timer_query, Load_ARB_timer_query},
 };
 
-static int g_extensionMapSize = 0;
+static int g_extensionMapSize = 1;
 
 static ogl_StrToExtMap *FindExtEntry(const char *extensionName)
 {
@@ -1045,6 +1068,7 @@ static ogl_StrToExtMap *FindExtEntry(const char *extensionName)
 
 static void ClearExtensionVars()
 {
+	ogl_ext_ARB_timer_query = ogl_LOAD_FAILED;
 }
 
 